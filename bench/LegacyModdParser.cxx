@@ -0,0 +1,146 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+
+#include "../metadata/Modd.hxx"
+#include "LegacyModdParser.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Heap-allocated VT record parsed through substr temporaries, as Modd used to keep them.
+*/
+struct LegacyVT {
+    uint32_t    field0;
+    uint32_t    field1;
+    double      field2;
+    double      field3;
+    double      field4;
+    uint32_t    field5;
+
+    explicit LegacyVT(const std::string& vtText) {
+        std::size_t splitPt = vtText.find(':');
+        field0 = std::stoul(vtText.substr(0, splitPt), nullptr, 10);
+
+        std::size_t oldSplit = splitPt;
+        splitPt = vtText.find(':', splitPt + 1);
+        field1 = std::stoul(vtText.substr(oldSplit + 1, splitPt), nullptr, 10);
+
+        oldSplit = splitPt;
+        splitPt = vtText.find(':', splitPt + 1);
+        field2 = std::stod(vtText.substr(oldSplit + 1, splitPt), nullptr);
+
+        oldSplit = splitPt;
+        splitPt = vtText.find(':', splitPt + 1);
+        field3 = std::stod(vtText.substr(oldSplit + 1, splitPt), nullptr);
+
+        oldSplit = splitPt;
+        splitPt = vtText.find(':', splitPt + 1);
+        field4 = std::stod(vtText.substr(oldSplit + 1, splitPt), nullptr);
+
+        oldSplit = splitPt;
+        splitPt = vtText.find(':', splitPt + 1);
+        field5 = std::stoul(vtText.substr(oldSplit + 1, splitPt), nullptr, 10);
+    }
+};
+
+static std::string vecToString(std::vector<char> txt) {
+    std::string result;
+
+    for (const auto& ltr : txt) {
+        result += ltr;
+        if (ltr == '\0') break;
+    }
+
+    return result;
+}
+
+static std::string cleanText(std::string& moddText) {
+    auto result = boost::algorithm::replace_first_copy(moddText, XML_HEADER, "");
+    boost::algorithm::replace_first(result, DATA_HEADER, "");
+    boost::algorithm::replace_first(result, DATA_FOOTER, "");
+
+    boost::algorithm::replace_all(result, "<key>", "");
+    boost::algorithm::replace_all(result, "</key>", ",");
+    boost::algorithm::replace_all(result, "<string>", "");
+    boost::algorithm::replace_all(result, "</string>", "\n");
+    boost::algorithm::replace_all(result, "<real>", "");
+    boost::algorithm::replace_all(result, "</real>", "\n");
+    boost::algorithm::replace_all(result, "<integer>", "");
+    boost::algorithm::replace_all(result, "</integer>", "\n");
+    boost::algorithm::replace_all(result, "<array>", "[\n");
+    boost::algorithm::replace_all(result, "</array>", "]");
+
+    boost::algorithm::trim_left(result);
+    boost::algorithm::trim_right(result);
+
+    return result;
+}
+
+LegacyModd memory_replay::parseLegacyModd(const fs::path& moddFilePath) {
+    LegacyModd modd = {0, 0, 0, 0, 0};
+    bool readArray = false;
+
+    std::ifstream moddFile(moddFilePath.string(), std::ios::ate | std::ios::binary);
+    if (!moddFile.is_open()) {
+        throw std::runtime_error("Failed to open target file.");
+    }
+
+    int numChars = moddFile.tellg();
+    moddFile.seekg(moddFile.beg);
+
+    std::vector<char> readBuf;
+    readBuf.resize(numChars + 1);
+    readBuf[numChars] = '\0';
+    moddFile.read(readBuf.data(), numChars);
+
+    moddFile.close();
+
+    std::string notBuf = vecToString(readBuf);
+    std::stringstream moddTxt;
+    moddTxt << cleanText(notBuf);
+
+    std::string line;
+    std::vector<LegacyVT*> vtList;
+
+    while (std::getline(moddTxt, line)) {
+        if (moddTxt.rdstate() != std::ios_base::goodbit) {
+            break;
+        }
+
+        if (!readArray) {
+            std::size_t commaLoc = line.find(",");
+            std::string key = line.substr(0, commaLoc);
+            std::string value = line.substr(commaLoc+1);
+
+            if (key == "CheckCode") {
+                modd.checkCode = std::stoul(value, nullptr, 16);
+            } else if (key == "DateTimeOriginal") {
+                modd.dateTimeOriginal = std::stof(value, nullptr);
+            } else if (key == "Duration") {
+                modd.duration = std::stof(value, nullptr);
+            } else if (key == "FileSize") {
+                modd.fileSize = std::stoull(value, nullptr, 10);
+            } else if (key == "VTList") {
+                if (value == "[") {
+                    readArray = true;
+                }
+            }
+        } else {
+            if (line.find("]") != std::string::npos) {
+                readArray = false;
+                continue;
+            }
+            vtList.push_back(new LegacyVT(line));
+        }
+    }
+
+    modd.vtCount = vtList.size();
+    for (auto& vt : vtList) {
+        delete vt;
+    }
+
+    return modd;
+}
@@ -0,0 +1,29 @@
+#ifndef MEMORY_REPLAY_LEGACY_MODD_PARSER_HXX
+#define MEMORY_REPLAY_LEGACY_MODD_PARSER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    /**
+     * Fields pulled out of a .modd file by the legacy parser.
+    */
+    struct LegacyModd {
+        uint32_t    checkCode;
+        float       dateTimeOriginal;
+        float       duration;
+        uint64_t    fileSize;
+        std::size_t vtCount;
+    };
+
+    /**
+     * The original cleanText/replace_all based .modd parser, kept only as a baseline
+     * for the parser benchmark.
+    */
+    LegacyModd parseLegacyModd(const fs::path& moddFilePath);
+};
+
+#endif // MEMORY_REPLAY_LEGACY_MODD_PARSER_HXX
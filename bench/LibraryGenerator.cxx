@@ -0,0 +1,86 @@
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <boost/format.hpp>
+
+#include "../metadata/Modd.hxx"
+#include "LibraryGenerator.hxx"
+
+using namespace memory_replay;
+
+static const double FIRST_CLIP_DAYS = 40194.4658912037;    // 2010-01-16 in days since Dec. 30 1899
+// Pack header, then a 720x480 sequence header and the extension that marks it as MPEG-2.
+static const uint8_t MPEG_HEADER[] = {0x00, 0x00, 0x01, 0xBA, 0x44, 0x00, 0x04, 0x00, 0x04, 0x01, 0x01, 0x89, 0xC3, 0xF8,
+    0x00, 0x00, 0x01, 0xB3, 0x2D, 0x01, 0xE0, 0x24, 0xFF, 0xFF, 0xE0, 0x18,
+    0x00, 0x00, 0x01, 0xB5, 0x14, 0x8A, 0x00, 0x01, 0x00, 0x00};
+static const uint8_t MP4_FTYP[] = {0x00, 0x00, 0x00, 0x18, 'f', 't', 'y', 'p', 'm', 'p', '4', '2', 0x00, 0x00, 0x00, 0x00,
+    'm', 'p', '4', '2', 'i', 's', 'o', 'm'};
+
+static void writeModd(const fs::path& path, std::size_t index, uint64_t videoSize) {
+    std::ofstream out(path, std::ios::binary);
+    out << XML_HEADER << DATA_HEADER;
+    out << boost::format("<key>CheckCode</key><string>%X</string>") % (0x1000 + index);
+    out << boost::format("<key>DateTimeOriginal</key><real>%.10f</real>") % (FIRST_CLIP_DAYS + index * 0.01);
+    out << boost::format("<key>Duration</key><real>%.2f</real>") % (30.0 + index % 600);
+    out << boost::format("<key>FileSize</key><integer>%d</integer>") % videoSize;
+    out << "<key>VTList</key><array>";
+    for (int vt = 0; vt < 8; vt++) {
+        out << boost::format("<string>%d:%d:%.6f:%.6f:%.6f:%d</string>") % vt % (vt * 15) % (vt * 12.5) % 0.5 % 1.5 % (vt + 3);
+    }
+    out << "</array>" << DATA_FOOTER;
+}
+
+static void writeVideo(const fs::path& path, std::size_t index, std::size_t size, bool mpeg, std::mt19937_64& rng) {
+    std::vector<uint8_t> data(size);
+    for (std::size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word = rng();
+        std::copy(reinterpret_cast<uint8_t*>(&word), reinterpret_cast<uint8_t*>(&word) + sizeof(word), data.begin() + i);
+    }
+
+    const uint8_t* header = mpeg ? MPEG_HEADER : MP4_FTYP;
+    std::size_t headerSize = mpeg ? sizeof(MPEG_HEADER) : sizeof(MP4_FTYP);
+    std::copy(header, header + std::min(headerSize, size), data.begin());
+
+    // The index right after the header keeps every head hash unique.
+    for (std::size_t i = 0; i < sizeof(index) && headerSize + i < size; i++) {
+        data[headerSize + i] = static_cast<uint8_t>(index >> (8 * i));
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+/**
+ * Writes a library of options.clips clips below root.
+ * @return the files written, in creation order.
+*/
+std::vector<GeneratedClip> LibraryGenerator::generate(const fs::path& root, const GeneratorOptions& options) {
+    std::vector<GeneratedClip> clips;
+    clips.reserve(options.clips);
+    std::mt19937_64 rng(options.seed);
+
+    std::size_t perDir = options.clipsPerDir > 0 ? options.clipsPerDir : 1;
+    fs::path dir;
+    for (std::size_t i = 0; i < options.clips; i++) {
+        if (i % perDir == 0) {
+            std::size_t dirIndex = i / perDir;
+            dir = root / (boost::format("%d-%d-%d") % (1 + dirIndex % 12) % (1 + dirIndex % 28) % (2010 + dirIndex / 336)).str();
+            fs::create_directories(dir);
+        }
+
+        std::string stem = (boost::format("%014d") % (20100116110730 + i)).str();
+        GeneratedClip clip;
+        clip.modd = dir / (stem + ".modd");
+        writeModd(clip.modd, i, options.payloadBytes);
+
+        if (options.payloadBytes > 0) {
+            bool mpeg = i % 2 == 0;
+            clip.video = dir / (stem + (mpeg ? ".MPG" : ".mp4"));
+            writeVideo(clip.video, i, options.payloadBytes, mpeg, rng);
+        }
+        clips.push_back(clip);
+    }
+
+    return clips;
+}
@@ -0,0 +1,38 @@
+#ifndef MEMORY_REPLAY_LIBRARY_GENERATOR_HXX
+#define MEMORY_REPLAY_LIBRARY_GENERATOR_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    struct GeneratorOptions {
+        std::size_t clips;          // Number of .modd/video pairs to write
+        std::size_t clipsPerDir;    // Clips per dated directory
+        std::size_t payloadBytes;   // Size of each fake video. 0 writes no videos at all
+        uint32_t    seed;           // Seed for payload contents
+    };
+
+    struct GeneratedClip {
+        fs::path    modd;
+        fs::path    video;          // Empty when no videos were written
+    };
+
+    /**
+     * Writes a synthetic camera library for benchmarks.
+     *
+     * Clips are spread over dated directories the way the camera lays them out
+     * (e.g. 1-16-2010/20100116110730.modd). Each .modd uses the exact header and footer
+     * from Modd.hxx. Each companion video alternates between .MPG and .mp4, starts with
+     * a container signature and is otherwise filled with unique pseudo-random bytes.
+    */
+    class LibraryGenerator {
+    public:
+        static std::vector<GeneratedClip> generate(const fs::path& root, const GeneratorOptions& options);
+    };
+};
+
+#endif // MEMORY_REPLAY_LIBRARY_GENERATOR_HXX
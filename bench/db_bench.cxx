@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/format.hpp>
+
+extern "C" {
+#include <sqlite3.h>
+};
+
+#include "../metadata/Modd.hxx"
+#include "../database/Database.hxx"
+#include "LibraryGenerator.hxx"
+
+using namespace memory_replay;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static const std::size_t DEFAULT_ROWS = 100000;
+
+/**
+ * Inserts modds the way Database::addEntries used to: every existence check and every
+ * insert prepares and finalizes its own statement.
+*/
+static void addEntriesUncached(sqlite3 *db, const std::vector<Modd*>& modds) {
+    static const string sqlStr = "SELECT * FROM modd WHERE checkCode == ?";
+
+    std::vector<Modd*> appendModds;
+    for (const auto& modd : modds) {
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v3(db, sqlStr.c_str(), -1, 0, &stmt, nullptr);
+        sqlite3_bind_int(stmt, 1, modd->getCheckCode());
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            appendModds.push_back(modd);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    for (const auto& modd : appendModds) {
+        sqlite3_stmt *stmt;
+        sqlite3_prepare_v3(db, MODD_INS_STR.c_str(), -1, 0, &stmt, nullptr);
+        sqlite3_bind_int(stmt, 1, modd->getCheckCode());
+        sqlite3_bind_text(stmt, 2, modd->getName().c_str(), modd->getName().length(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 3, modd->getDateTimeActual());
+        sqlite3_bind_double(stmt, 4, modd->getDuration());
+        sqlite3_bind_int64(stmt, 5, modd->getFileSize());
+        string location = modd->getPath().path();
+        sqlite3_bind_text(stmt, 6, location.c_str(), location.length(), SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+}
+
+/**
+ * Measures modd rows/sec through Database::addEntries against per-row statement preparation,
+ * then full-table reads through query() against a Cursor and a columnar fetch.
+ *
+ * Usage: db-bench [rows]
+*/
+int main(int argc, char** argv) {
+    std::size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_ROWS;
+
+    fs::path workDir = fs::temp_directory_path() / "db-bench";
+    fs::remove_all(workDir);
+
+    std::vector<std::unique_ptr<Modd>> owned;
+    std::vector<Modd*> modds;
+    for (const auto& clip : LibraryGenerator::generate(workDir / "modd", {rows, rows, 0, 1})) {
+        owned.emplace_back(new Modd(clip.modd));
+        modds.push_back(owned.back().get());
+    }
+
+    double uncachedSecs;
+    {
+        // Database creates the schema; the legacy path then runs on its own connection.
+        fs::path dbPath = workDir / "uncached.db";
+        { Database schema(dbPath); }
+
+        sqlite3 *db;
+        sqlite3_open(dbPath.c_str(), &db);
+        auto start = Clock::now();
+        addEntriesUncached(db, modds);
+        uncachedSecs = std::chrono::duration<double>(Clock::now() - start).count();
+        sqlite3_close(db);
+    }
+
+    double cachedSecs;
+    double querySecs;
+    double cursorSecs;
+    double fetchSecs;
+    {
+        Database db(workDir / "cached.db");
+        auto start = Clock::now();
+        db.addEntries(modds);
+        cachedSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+        static const string scanSql = "SELECT checkCode, name, dateTime, videoDuration, videoFileSize, moddFileLocation FROM modd";
+        std::size_t checksum = 0;
+
+        start = Clock::now();
+        for (const auto& row : db.query(scanSql)) {
+            checksum += row.at("name").size();
+        }
+        querySecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        Cursor cursor = db.cursor(scanSql);
+        while (cursor.step()) {
+            checksum += cursor.getText(1).size() + cursor.getInt64(2);
+        }
+        cursorSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        Cursor columnar = db.cursor(scanSql);
+        ColumnBatch batch({ColumnType::INTEGER, ColumnType::TEXT, ColumnType::INTEGER,
+            ColumnType::REAL, ColumnType::INTEGER, ColumnType::TEXT});
+        while (columnar.fetch(batch, 4096) > 0) {
+            for (std::size_t i = 0; i < batch.rows(); i++) {
+                checksum += batch.text(1, i).size() + batch.integers(2)[i];
+            }
+            batch.clear();
+        }
+        fetchSecs = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Keeps the reads from being optimized away.
+        std::cerr << boost::format("checksum %d\n") % checksum;
+    }
+
+    std::cout << boost::format("%d modd rows\n") % rows;
+    std::cout << boost::format("%-10s %12.0f rows/sec\n") % "uncached" % (rows / uncachedSecs);
+    std::cout << boost::format("%-10s %12.0f rows/sec\n") % "cached" % (rows / cachedSecs);
+    std::cout << boost::format("speedup    %12.2fx\n") % (uncachedSecs / cachedSecs);
+    std::cout << boost::format("%-10s %12.0f rows/sec\n") % "query" % (rows / querySecs);
+    std::cout << boost::format("%-10s %12.0f rows/sec\n") % "cursor" % (rows / cursorSecs);
+    std::cout << boost::format("%-10s %12.0f rows/sec\n") % "fetch" % (rows / fetchSecs);
+
+    fs::remove_all(workDir);
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "../metadata/Modd.hxx"
+#include "../metadata/Video.hxx"
+#include "../metadata/BatchHasher.hxx"
+#include "../database/Database.hxx"
+#include "../ingest/Pipeline.hxx"
+#include "LibraryGenerator.hxx"
+
+using namespace memory_replay;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static const std::size_t DEFAULT_PAYLOAD = 16384;
+static const std::size_t CLIPS_PER_DIR = 20;
+
+/**
+ * Latency samples for one stage.
+*/
+class StageTimes {
+public:
+    explicit StageTimes(string name) : m_name(name), m_items(0), m_totalSecs(0) {};
+
+    template<typename Fn>
+    void time(std::size_t items, Fn fn) {
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        this->m_samples.push_back(elapsed.count());
+        this->m_totalSecs += elapsed.count();
+        this->m_items += items;
+    };
+
+    void report(std::ostream& out) {
+        std::sort(this->m_samples.begin(), this->m_samples.end());
+        out << boost::format("%-10s %10d %12.0f %10.1f %10.1f %10.1f %10.1f\n") % this->m_name % this->m_items %
+            (this->m_items / this->m_totalSecs) % (this->percentile(0.50) * 1e6) % (this->percentile(0.90) * 1e6) %
+            (this->percentile(0.99) * 1e6) % (this->m_samples.back() * 1e6);
+    };
+private:
+    string              m_name;
+    std::size_t         m_items;
+    double              m_totalSecs;
+    std::vector<double> m_samples;
+
+    double percentile(double p) const {
+        std::size_t index = static_cast<std::size_t>(p * (this->m_samples.size() - 1));
+        return this->m_samples[index];
+    };
+};
+
+/**
+ * Hashes every video through a BatchHasher, keeping as many files in flight as it allows.
+*/
+static void hashBatched(const std::vector<GeneratedClip>& clips, HashStrategy strategy, IoEngine ioEngine,
+        std::vector<Hash>& hashes) {
+    auto engine = ReadEngine::create(ioEngine, DEFAULT_IO_DEPTH, DEFAULT_IO_BUFFERS);
+    BatchHasher hasher(*engine);
+    hashes.resize(clips.size());
+
+    std::size_t started = 0;
+    while (started < clips.size() || !hasher.idle()) {
+        while (started < clips.size() && hasher.canStart()) {
+            hasher.start(clips[started].video, strategy, started);
+            started++;
+        }
+        Hash hash;
+        bool ok;
+        uint64_t tag = hasher.next(hash, ok);
+        hashes[tag] = std::move(hash);
+    }
+}
+
+static void runSuite(const fs::path& workDir, std::size_t clipCount, std::size_t payload, HashStrategy strategy,
+        IoEngine ioEngine) {
+    fs::remove_all(workDir);
+    auto clips = LibraryGenerator::generate(workDir / "library", {clipCount, CLIPS_PER_DIR, payload, 42});
+
+    StageTimes parse("parse");
+    StageTimes hash("hash");
+    StageTimes hashIo("hash-io");
+    StageTimes addModds("db-modd");
+    StageTimes updateVideos("db-video");
+    StageTimes relocate("relocate");
+
+    std::vector<std::unique_ptr<Modd>> modds;
+    std::vector<std::unique_ptr<Video>> videos;
+    modds.reserve(clips.size());
+    videos.reserve(clips.size());
+
+    for (const auto& clip : clips) {
+        parse.time(1, [&] { modds.emplace_back(new Modd(clip.modd)); });
+    }
+    for (std::size_t i = 0; i < clips.size(); i++) {
+        hash.time(1, [&] { videos.emplace_back(new Video(*modds[i], clips[i].video, strategy)); });
+    }
+    if (ioEngine != IoEngine::INLINE) {
+        std::vector<Hash> hashes;
+        hashIo.time(clips.size(), [&] { hashBatched(clips, strategy, ioEngine, hashes); });
+        for (std::size_t i = 0; i < clips.size(); i++) {
+            if (hashes[i] != videos[i]->getHash()) {
+                std::cerr << "batched hash differs for " << clips[i].video << std::endl;
+            }
+        }
+    }
+
+    {
+        // updateEntries logs a line per batch; keep it out of the report.
+        auto clogBuf = std::clog.rdbuf(nullptr);
+        Database db(workDir / "library.db");
+        for (std::size_t start = 0; start < clips.size(); start += DEFAULT_BATCH_SIZE) {
+            std::size_t end = std::min(start + DEFAULT_BATCH_SIZE, clips.size());
+            vector<Modd*> batchModds;
+            vector<Video*> batchVideos;
+            for (std::size_t i = start; i < end; i++) {
+                batchModds.push_back(modds[i].get());
+                batchVideos.push_back(videos[i].get());
+            }
+            addModds.time(batchModds.size(), [&] { db.addEntries(batchModds); });
+            updateVideos.time(batchVideos.size(), [&] { db.updateEntries(batchVideos); });
+        }
+        std::clog.clear();
+        std::clog.rdbuf(clogBuf);
+    }
+
+    fs::path outDir = workDir / "relocated/";
+    for (auto& video : videos) {
+        relocate.time(1, [&] { video->relocate(outDir); });
+    }
+
+    std::cout << boost::format("\n== %d clips, %d byte videos ==\n") % clipCount % payload;
+    std::cout << boost::format("%-10s %10s %12s %10s %10s %10s %10s\n") % "stage" % "items" % "items/sec" %
+        "p50 us" % "p90 us" % "p99 us" % "max us";
+    parse.report(std::cout);
+    hash.report(std::cout);
+    if (ioEngine != IoEngine::INLINE) {
+        hashIo.report(std::cout);
+    }
+    addModds.report(std::cout);
+    updateVideos.report(std::cout);
+    relocate.report(std::cout);
+
+    fs::remove_all(workDir);
+}
+
+/**
+ * End-to-end stage benchmark over synthetic libraries.
+ * Latencies are per file, except the db stages which are per batch of DEFAULT_BATCH_SIZE rows.
+ * Files are read back while still in the page cache.
+ * With --io, videos are hashed again through a BatchHasher on that engine; its row is one
+ * sample covering every file, so only its items/sec is meaningful.
+ *
+ * Usage: ingest-bench [--sizes 1000,10000,100000] [--payload bytes] [--strategy head|sampled|full]
+ *        [--io threads|uring] [--dir path]
+*/
+int main(int argc, char** argv) {
+    std::vector<std::size_t> sizes = {1000, 10000, 100000};
+    std::size_t payload = DEFAULT_PAYLOAD;
+    HashStrategy strategy = HashStrategy::HEAD;
+    IoEngine ioEngine = IoEngine::INLINE;
+    fs::path workDir = fs::temp_directory_path() / "ingest-bench";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        string value = argv[i + 1];
+        if (arg == "--sizes") {
+            sizes.clear();
+            std::stringstream list(value);
+            string size;
+            while (std::getline(list, size, ',')) {
+                sizes.push_back(std::stoul(size));
+            }
+        } else if (arg == "--payload") {
+            payload = std::stoul(value);
+        } else if (arg == "--strategy") {
+            if (!Fingerprint::parseStrategy(value, strategy)) {
+                std::cerr << "unknown fingerprint strategy: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--io") {
+            if (!ReadEngine::parseEngine(value, ioEngine)) {
+                std::cerr << "unknown io engine: " << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--dir") {
+            workDir = fs::path(value) / "ingest-bench";
+        } else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    for (auto size : sizes) {
+        runSuite(workDir, size, payload, strategy, ioEngine);
+    }
+
+    return 0;
+}
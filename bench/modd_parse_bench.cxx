@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "../metadata/Modd.hxx"
+#include "LegacyModdParser.hxx"
+#include "LibraryGenerator.hxx"
+
+using namespace memory_replay;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static const std::size_t SAMPLE_FILES = 1000;
+static const int DEFAULT_ROUNDS = 5;
+
+template<typename Fn>
+static double filesPerSec(const std::vector<fs::path>& files, int rounds, Fn parse) {
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto& file : files) {
+            parse(file);
+        }
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    return (files.size() * rounds) / elapsed.count();
+}
+
+/**
+ * Compares .modd parsing throughput of the legacy parser against Modd.
+ *
+ * Usage: modd-parse-bench [modd directory] [rounds]
+*/
+int main(int argc, char** argv) {
+    fs::path moddDir;
+    bool generated = false;
+    if (argc > 1) {
+        moddDir = fs::path(argv[1]);
+    } else {
+        moddDir = fs::temp_directory_path() / "modd-parse-bench";
+        LibraryGenerator::generate(moddDir, {SAMPLE_FILES, SAMPLE_FILES, 0, 1});
+        generated = true;
+    }
+    int rounds = argc > 2 ? std::atoi(argv[2]) : DEFAULT_ROUNDS;
+
+    std::vector<fs::path> files;
+    for (auto& p : fs::recursive_directory_iterator(moddDir)) {
+        if (p.is_regular_file() && p.path().extension() == ".modd") {
+            files.push_back(p.path());
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "No .modd files found in " << moddDir << std::endl;
+        return 1;
+    }
+
+    // Both parsers must agree before their speed means anything.
+    for (const auto& file : files) {
+        LegacyModd legacy = parseLegacyModd(file);
+        Modd modd(file);
+        if (legacy.checkCode != modd.getCheckCode() || legacy.fileSize != modd.getFileSize() ||
+            legacy.duration != modd.getDuration() || legacy.vtCount != modd.getVTList().size()) {
+            std::cerr << "Parsers disagree on " << file << std::endl;
+            return 1;
+        }
+    }
+
+    double legacyRate = filesPerSec(files, rounds, [](const fs::path& file) { parseLegacyModd(file); });
+    double moddRate = filesPerSec(files, rounds, [](const fs::path& file) { Modd modd(file); });
+
+    std::cout << boost::format("%d files x %d rounds\n") % files.size() % rounds;
+    std::cout << boost::format("%-10s %12.0f files/sec\n") % "legacy" % legacyRate;
+    std::cout << boost::format("%-10s %12.0f files/sec\n") % "modd" % moddRate;
+    std::cout << boost::format("speedup    %12.2fx\n") % (moddRate / legacyRate);
+
+    if (generated) {
+        fs::remove_all(moddDir);
+    }
+
+    return 0;
+}
@@ -3,12 +3,58 @@
 
 #include <map>
 
+extern "C" {
+#include <getopt.h>
+};
+
 namespace memory_replay {
-    static const char OPTS_STR[] = ":u:r:";
+    static const char OPTS_STR[] = ":u:r:j:if:sb:d:q:w:e:";
+
+    // Values for options that only have a long form. Kept clear of any short option character.
+    enum LongOnlyOption {
+        STATS_OPT = 256,
+        DB_PROFILE_OPT,
+        SHARDS_OPT,
+        ENCODE_DIR_OPT,
+        IO_ENGINE_OPT,
+        IO_THREADS_OPT,
+        IO_DEPTH_OPT,
+        IO_BUFFERS_OPT
+    };
+
+    static const struct option LONG_OPTS[] = {
+        {"update",      required_argument,  nullptr,    'u'},
+        {"relocate",    required_argument,  nullptr,    'r'},
+        {"jobs",        required_argument,  nullptr,    'j'},
+        {"incremental", no_argument,        nullptr,    'i'},
+        {"fingerprint", required_argument,  nullptr,    'f'},
+        {"stream",      no_argument,        nullptr,    's'},
+        {"batch",       required_argument,  nullptr,    'b'},
+        {"dupes",       required_argument,  nullptr,    'd'},
+        {"queue",       required_argument,  nullptr,    'q'},
+        {"watch",       required_argument,  nullptr,    'w'},
+        {"export",      required_argument,  nullptr,    'e'},
+        {"shards",      required_argument,  nullptr,    SHARDS_OPT},
+        {"encode-dir",  required_argument,  nullptr,    ENCODE_DIR_OPT},
+        {"stats",       optional_argument,  nullptr,    STATS_OPT},
+        {"db-profile",  required_argument,  nullptr,    DB_PROFILE_OPT},
+        {"io-engine",   required_argument,  nullptr,    IO_ENGINE_OPT},
+        {"io-threads",  required_argument,  nullptr,    IO_THREADS_OPT},
+        {"io-depth",    required_argument,  nullptr,    IO_DEPTH_OPT},
+        {"io-buffers",  required_argument,  nullptr,    IO_BUFFERS_OPT},
+        {nullptr,       0,                  nullptr,    0}
+    };
 
     enum class Option {
         Update,
-        Relocate
+        Relocate,
+        Incremental,
+        Stream,
+        Dupes,
+        Queue,
+        Watch,
+        Export,
+        Stats
     };
 };
-#endif // MEMORY_REPLAY_CONFIG_HXX
\ No newline at end of file
+#endif // MEMORY_REPLAY_CONFIG_HXX
@@ -0,0 +1,214 @@
+#include <stdexcept>
+#include <utility>
+
+#include "Cursor.hxx"
+
+using namespace memory_replay;
+
+/**
+ * @param types how each result column will be stored, in select order.
+*/
+ColumnBatch::ColumnBatch(std::vector<ColumnType> types) : m_rows(0) {
+    this->m_columns.resize(types.size());
+    for (std::size_t i = 0; i < types.size(); i++) {
+        this->m_columns[i].type = types[i];
+        this->m_columns[i].offsets.push_back(0);
+    }
+}
+
+/**
+ * Drops every row while keeping the memory allocated for them.
+*/
+void ColumnBatch::clear() {
+    for (auto& column : this->m_columns) {
+        column.integers.clear();
+        column.reals.clear();
+        column.bytes.clear();
+        column.offsets.resize(1);
+    }
+    this->m_rows = 0;
+}
+
+Span<const int64_t> ColumnBatch::integers(std::size_t col) const {
+    const auto& values = this->m_columns.at(col).integers;
+    return Span<const int64_t>(values.data(), values.size());
+}
+
+Span<const double> ColumnBatch::reals(std::size_t col) const {
+    const auto& values = this->m_columns.at(col).reals;
+    return Span<const double>(values.data(), values.size());
+}
+
+std::string_view ColumnBatch::text(std::size_t col, std::size_t row) const {
+    const Column& column = this->m_columns.at(col);
+    std::size_t start = column.offsets.at(row);
+    return std::string_view(column.bytes.data() + start, column.offsets.at(row + 1) - start);
+}
+
+Span<const uint8_t> ColumnBatch::blob(std::size_t col, std::size_t row) const {
+    std::string_view bytes = this->text(col, row);
+    return Span<const uint8_t>(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+}
+
+/**
+ * Prepares sql on db.
+ * @throws std::runtime_error if the statement doesn't compile.
+*/
+Cursor::Cursor(sqlite3* db, const std::string& sql) : m_db(db), m_stmt(nullptr), m_done(false) {
+    if (sqlite3_prepare_v3(db, sql.c_str(), sql.length(), 0, &this->m_stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(this->m_stmt);
+        throw std::runtime_error(sqlite3_errmsg(db));
+    }
+}
+
+Cursor::Cursor(Cursor&& other) noexcept : m_db(other.m_db), m_stmt(other.m_stmt), m_done(other.m_done) {
+    other.m_stmt = nullptr;
+}
+
+Cursor::~Cursor() {
+    sqlite3_finalize(this->m_stmt);
+}
+
+Cursor& Cursor::bind(int index, int64_t value) {
+    this->check(sqlite3_bind_int64(this->m_stmt, index, value));
+    return *this;
+}
+
+Cursor& Cursor::bind(int index, double value) {
+    this->check(sqlite3_bind_double(this->m_stmt, index, value));
+    return *this;
+}
+
+/**
+ * Binds text without copying it. value must stay alive until the cursor is reset.
+*/
+Cursor& Cursor::bind(int index, std::string_view value) {
+    this->check(sqlite3_bind_text(this->m_stmt, index, value.data(), value.size(), SQLITE_STATIC));
+    return *this;
+}
+
+/**
+ * Binds a blob without copying it. value must stay alive until the cursor is reset.
+*/
+Cursor& Cursor::bind(int index, Span<const uint8_t> value) {
+    this->check(sqlite3_bind_blob(this->m_stmt, index, value.data(), value.size(), SQLITE_STATIC));
+    return *this;
+}
+
+/**
+ * Moves to the next row.
+ * @return true if a row is available, false once the results are exhausted.
+ * @throws std::runtime_error if SQLite reports an error.
+*/
+bool Cursor::step() {
+    if (this->m_done) {
+        return false;
+    }
+
+    int result = sqlite3_step(this->m_stmt);
+    if (result == SQLITE_ROW) {
+        return true;
+    }
+    this->m_done = true;
+    if (result != SQLITE_DONE) {
+        throw std::runtime_error(sqlite3_errmsg(this->m_db));
+    }
+    return false;
+}
+
+/**
+ * Rewinds the statement so it can be stepped again. Bindings are kept.
+*/
+void Cursor::reset() {
+    sqlite3_reset(this->m_stmt);
+    this->m_done = false;
+}
+
+int Cursor::columnCount() const {
+    return sqlite3_column_count(this->m_stmt);
+}
+
+std::string_view Cursor::columnName(int col) const {
+    return sqlite3_column_name(this->m_stmt, col);
+}
+
+bool Cursor::isNull(int col) const {
+    return sqlite3_column_type(this->m_stmt, col) == SQLITE_NULL;
+}
+
+int64_t Cursor::getInt64(int col) const {
+    return sqlite3_column_int64(this->m_stmt, col);
+}
+
+double Cursor::getDouble(int col) const {
+    return sqlite3_column_double(this->m_stmt, col);
+}
+
+/**
+ * @return the column as text. Empty for NULL.
+*/
+std::string_view Cursor::getText(int col) const {
+    auto text = reinterpret_cast<const char*>(sqlite3_column_text(this->m_stmt, col));
+    if (text == nullptr) {
+        return std::string_view();
+    }
+    return std::string_view(text, sqlite3_column_bytes(this->m_stmt, col));
+}
+
+/**
+ * @return the column as raw bytes. Empty for NULL.
+*/
+Span<const uint8_t> Cursor::getBlob(int col) const {
+    auto data = static_cast<const uint8_t*>(sqlite3_column_blob(this->m_stmt, col));
+    return Span<const uint8_t>(data, sqlite3_column_bytes(this->m_stmt, col));
+}
+
+/**
+ * Steps through up to maxRows rows, appending each to batch column by column.
+ *
+ * @param batch receives the rows. Its column count must match the statement's.
+ * @param maxRows most rows to fetch in this call.
+ * @return rows fetched. Fewer than maxRows means the results are exhausted.
+*/
+std::size_t Cursor::fetch(ColumnBatch& batch, std::size_t maxRows) {
+    if (batch.m_columns.size() != static_cast<std::size_t>(this->columnCount())) {
+        throw std::runtime_error("Column batch doesn't match the statement's columns.");
+    }
+
+    std::size_t fetched = 0;
+    while (fetched < maxRows && this->step()) {
+        for (std::size_t col = 0; col < batch.m_columns.size(); col++) {
+            auto& column = batch.m_columns[col];
+            switch (column.type) {
+                case ColumnType::INTEGER:
+                    column.integers.push_back(this->getInt64(col));
+                    break;
+                case ColumnType::REAL:
+                    column.reals.push_back(this->getDouble(col));
+                    break;
+                case ColumnType::TEXT: {
+                    std::string_view text = this->getText(col);
+                    column.bytes.append(text.data(), text.size());
+                    column.offsets.push_back(column.bytes.size());
+                    break;
+                }
+                case ColumnType::BLOB: {
+                    Span<const uint8_t> blob = this->getBlob(col);
+                    column.bytes.append(reinterpret_cast<const char*>(blob.data()), blob.size());
+                    column.offsets.push_back(column.bytes.size());
+                    break;
+                }
+            }
+        }
+        fetched++;
+    }
+    batch.m_rows += fetched;
+
+    return fetched;
+}
+
+void Cursor::check(int result) const {
+    if (result != SQLITE_OK) {
+        throw std::runtime_error(sqlite3_errmsg(this->m_db));
+    }
+}
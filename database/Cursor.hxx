@@ -0,0 +1,102 @@
+#ifndef MEMORY_REPLAY_CURSOR_HXX
+#define MEMORY_REPLAY_CURSOR_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include <sqlite3.h>
+};
+
+#include "../metadata/Span.hxx"
+
+namespace memory_replay {
+    /**
+     * How a ColumnBatch stores one result column.
+    */
+    enum class ColumnType {
+        INTEGER,
+        REAL,
+        TEXT,
+        BLOB
+    };
+
+    /**
+     * Column-major storage for many rows of a result set.
+     *
+     * Integers and reals are kept in flat arrays. Text and blobs share one byte arena per
+     * column, with an offset per row. Clearing keeps the capacity, so refilling the same
+     * batch doesn't allocate once it has grown to size.
+    */
+    class ColumnBatch {
+    public:
+        explicit ColumnBatch(std::vector<ColumnType> types);
+
+        std::size_t rows()      const { return this->m_rows; };
+        std::size_t columns()   const { return this->m_columns.size(); };
+        void        clear();
+
+        Span<const int64_t>     integers(std::size_t col)               const;
+        Span<const double>      reals(std::size_t col)                  const;
+        std::string_view        text(std::size_t col, std::size_t row)  const;
+        Span<const uint8_t>     blob(std::size_t col, std::size_t row)  const;
+    private:
+        friend class Cursor;
+
+        struct Column {
+            ColumnType              type;
+            std::vector<int64_t>    integers;
+            std::vector<double>     reals;
+            std::string             bytes;      // Text and blob values, back to back
+            std::vector<std::size_t> offsets;   // Start of each value in bytes, plus the end
+        };
+
+        std::vector<Column>     m_columns;
+        std::size_t             m_rows;
+    };
+
+    /**
+     * Forward-only cursor over the results of one prepared statement.
+     *
+     * Column values are read straight out of SQLite without converting them to text.
+     * Text and blob views stay valid until the next step() or reset(). A Cursor must not
+     * outlive the connection it was opened on.
+    */
+    class Cursor {
+    public:
+        Cursor(sqlite3* db, const std::string& sql);
+        Cursor(Cursor&& other) noexcept;
+        Cursor(const Cursor&) = delete;
+        Cursor& operator=(const Cursor&) = delete;
+        ~Cursor();
+
+        Cursor& bind(int index, int64_t value);
+        Cursor& bind(int index, double value);
+        Cursor& bind(int index, std::string_view value);
+        Cursor& bind(int index, Span<const uint8_t> value);
+
+        bool step();
+        void reset();
+
+        int                 columnCount()   const;
+        std::string_view    columnName(int col) const;
+        bool                isNull(int col) const;
+        int64_t             getInt64(int col)   const;
+        double              getDouble(int col)  const;
+        std::string_view    getText(int col)    const;
+        Span<const uint8_t> getBlob(int col)    const;
+
+        std::size_t fetch(ColumnBatch& batch, std::size_t maxRows);
+    private:
+        sqlite3*        m_db;
+        sqlite3_stmt*   m_stmt;
+        bool            m_done;
+
+        void check(int result) const;
+    };
+};
+
+#endif // MEMORY_REPLAY_CURSOR_HXX
@@ -1,19 +1,39 @@
 #include <iostream>
 #include <sstream>
+#include <string_view>
 
 #include <boost/format.hpp>
 
 #include "Database.hxx"
+#include "../stats/Stats.hxx"
 
 using namespace memory_replay;
 
-Database::Database(fs::path dbPath) {
+/**
+ * Opens (creating if needed) the database at dbPath and brings its schema up to date.
+ * @param profile journal, sync and cache settings for this connection.
+*/
+Database::Database(fs::path dbPath, const DatabaseProfile& profile) {
+    for (auto& stmt : this->m_statements) {
+        stmt = nullptr;
+    }
+    this->m_keysLoaded = false;
+
     int result = sqlite3_open(dbPath.c_str(), &this->m_dbHandle);
     if (result != SQLITE_OK) {
         string errStr = sqlite3_errmsg(this->m_dbHandle);
+        sqlite3_close(this->m_dbHandle);
         throw std::runtime_error(errStr);
     }
 
+    // The journal mode can't change inside a transaction, so this comes first.
+    try {
+        this->applyProfile(profile);
+    } catch (const std::runtime_error& e) {
+        sqlite3_close(this->m_dbHandle);
+        throw;
+    }
+
     // Set up any missing tables if they don't already exist.
     sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", 0, nullptr, nullptr);
     sqlite3_stmt *stmt;
@@ -26,10 +46,28 @@ Database::Database(fs::path dbPath) {
     sqlite3_prepare_v3(this->m_dbHandle, PREPARE_VIDEO_TABLE.c_str(), PREPARE_VIDEO_TABLE.length(), 0, &stmt, nullptr);
     sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+
+    // File signature table
+    sqlite3_prepare_v3(this->m_dbHandle, PREPARE_SIGNATURE_TABLE.c_str(), PREPARE_SIGNATURE_TABLE.length(), 0, &stmt, nullptr);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    // Bring older databases up to the current schema.
+    try {
+        this->migrate();
+    } catch (const std::runtime_error& e) {
+        sqlite3_exec(this->m_dbHandle, "ROLLBACK", 0, nullptr, nullptr);
+        sqlite3_close(this->m_dbHandle);
+        throw;
+    }
     sqlite3_exec(this->m_dbHandle, "COMMIT", 0, nullptr, nullptr);
 }
 
 Database::~Database() {
+    for (auto& stmt : this->m_statements) {
+        sqlite3_finalize(stmt);
+    }
+
     int result = sqlite3_close(this->m_dbHandle);
     if (result != SQLITE_OK) {
         string errStr = sqlite3_errmsg(this->m_dbHandle);
@@ -37,69 +75,135 @@ Database::~Database() {
     }
 }
 
-Video Database::get(Hash hash) {
-    static const std::string vidSelect = "SELECT * FROM video WHERE hash == ?";
+/**
+ * Sets the connection pragmas described by a profile.
+*/
+void Database::applyProfile(const DatabaseProfile& profile) {
+    sqlite3_busy_timeout(this->m_dbHandle, profile.busyTimeoutMs);
+
+    const string pragmas[] = {
+        string("PRAGMA journal_mode = ") + (profile.wal ? "WAL" : "DELETE"),
+        string("PRAGMA synchronous = ") + (profile.syncNormal ? "NORMAL" : "FULL"),
+        "PRAGMA mmap_size = " + std::to_string(profile.mmapSize),
+        "PRAGMA cache_size = " + std::to_string(profile.cacheSize),
+        string("PRAGMA temp_store = ") + (profile.tempStoreMemory ? "MEMORY" : "DEFAULT")
+    };
+    for (const auto& pragma : pragmas) {
+        if (this->execStatement(pragma, 0) != 0) {
+            throw std::runtime_error(sqlite3_errmsg(this->m_dbHandle));
+        }
+    }
+}
 
+/**
+ * Applies every entry in MIGRATIONS that the database hasn't seen yet.
+ * Runs inside the constructor's transaction, so a failed migration leaves nothing behind.
+*/
+void Database::migrate() {
     sqlite3_stmt *stmt;
-    int result = sqlite3_prepare_v3(this->m_dbHandle, vidSelect.c_str(), vidSelect.length() + hash.size(), 0, &stmt, nullptr);
-    sqlite3_bind_blob(stmt, 1, hash.data(), hash.size(), SQLITE_TRANSIENT);
+    int version = 0;
+    sqlite3_prepare_v3(this->m_dbHandle, "PRAGMA user_version", -1, 0, &stmt, nullptr);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    const int numMigrations = sizeof(MIGRATIONS) / sizeof(MIGRATIONS[0]);
+    for (int i = version; i < numMigrations; i++) {
+        if (this->execStatement(MIGRATIONS[i], 0) != 0) {
+            throw std::runtime_error(sqlite3_errmsg(this->m_dbHandle));
+        }
+        this->execStatement("PRAGMA user_version = " + std::to_string(i + 1), 0);
+    }
+}
+
+/**
+ * Gets one of the cached statements, preparing it on first use.
+ * The statement comes back reset with its bindings cleared, ready to be bound and stepped.
+ *
+ * @param statement which statement to fetch.
+ * @return prepared statement owned by this Database. Never finalize it.
+*/
+sqlite3_stmt *Database::prepared(Statement statement) const {
+    static const string *const SQL[] = {
+        &MODD_INS_STR,
+        &VIDEO_INS_STR,
+        &VIDEO_SELECT_STR,
+        &VIDEO_MODD_HASH_STR,
+        &VIDEO_UPDATE_STR,
+        &SIGNATURE_UPSERT_STR,
+        &VIDEO_MOVE_STR,
+        &MODD_MOVE_STR,
+        &SIGNATURE_MOVE_STR
+    };
+    static_assert(sizeof(SQL) / sizeof(SQL[0]) == static_cast<std::size_t>(Statement::COUNT),
+        "Every cached statement needs its SQL");
+
+    auto index = static_cast<std::size_t>(statement);
+    sqlite3_stmt *&stmt = this->m_statements[index];
+    if (stmt == nullptr) {
+        const string& sql = *SQL[index];
+        if (sqlite3_prepare_v3(this->m_dbHandle, sql.c_str(), sql.length(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            stmt = nullptr;
+            throw std::runtime_error(sqlite3_errmsg(this->m_dbHandle));
+        }
+    } else {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+    return stmt;
+}
+
+Video Database::get(Hash hash) {
+    sqlite3_stmt *stmt = this->prepared(Statement::SELECT_VIDEO);
+    sqlite3_bind_blob(stmt, 1, hash.data(), hash.size(), SQLITE_STATIC);
 
-    std::string name;
-    uint32_t moddCheckCode;
     uint64_t dateTime;
     double duration;
     fs::path fileLoc;
-    uint64_t fileSize;
-    if ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
-        name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        moddCheckCode = sqlite3_column_int(stmt, 2);
+    HashStrategy hashStrategy;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
         dateTime = sqlite3_column_int64(stmt, 3);
         duration = sqlite3_column_double(stmt, 4);
         fileLoc = fs::path(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5)));
-        fileSize = sqlite3_column_int64(stmt, 6);
+        hashStrategy = static_cast<HashStrategy>(sqlite3_column_int(stmt, 7));
     } else {
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         throw std::runtime_error("Failed to find matching entry in database.");
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
-    return Video(name, fileLoc, dateTime, duration, hash);
+    return Video(fileLoc, dateTime, duration, hash, hashStrategy);
 }
 
 /**
- * Finds Rows matching the provided statement.
- * 
- * @param stmt SQL select statement.
- * @return a vector containing all matched rows.
+ * Runs a single statement and collects every row as text keyed by column name.
+ * Convenient for small results; use cursor() for anything large.
 */
 Rows Database::query(const string& stmt) {
     Rows rows;
 
-    int result = sqlite3_exec(
-        this->m_dbHandle,
-        stmt.c_str(),
-        this->handleQuery,
-        &rows,
-        nullptr
-    );
+    Cursor cursor = this->cursor(stmt);
+    while (cursor.step()) {
+        Row row;
+        for (int i = 0; i < cursor.columnCount(); i++) {
+            row[string(cursor.columnName(i))] = string(cursor.getText(i));
+        }
+        rows.push_back(std::move(row));
+    }
 
     return rows;
 }
 
 /**
- * Callback for handling db queries.
- * Appends a row (map<string, string>) to a Rows vector.
+ * Prepares a statement for typed, row-by-row or columnar reads.
+ * @param sql a single SQL statement.
+ * @return cursor over the statement's results. Must not outlive this Database.
 */
-int Database::handleQuery(void* rows, int numCols, char** colVals, char** colNames) {
-    auto rowsPtr = static_cast<Rows*>(rows);
-    Row row;
-    for (int i = 0; i < numCols; i++) {
-        row[string(colNames[i])] = string(colVals[i]);
-    }
-
-    rowsPtr->push_back(row);
-    return 0;
+Cursor Database::cursor(const string& sql) const {
+    return Cursor(this->m_dbHandle, sql);
 }
 
 /**
@@ -119,7 +223,8 @@ int Database::execStatement(string statement, unsigned int flags) {
     }
 
     result = sqlite3_step(sqlStmt);
-    if (result != SQLITE_DONE) {
+    if (result != SQLITE_DONE && result != SQLITE_ROW) {
+        sqlite3_finalize(sqlStmt);
         return result;
     }
 
@@ -142,18 +247,8 @@ int Database::execStatement(string statement, unsigned int flags) {
  * @return true if found in db. false, otherwise.
 */
 bool Database::contains(const Modd& modd) const {
-    string sqlStr = "SELECT * FROM modd WHERE checkCode == ?";
-
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v3(this->m_dbHandle, sqlStr.c_str(), sqlStr.size() + 8, 0, &stmt, nullptr);
-
-    sqlite3_bind_int(stmt, 1, modd.getCheckCode());
-
-    int stepResult = sqlite3_step(stmt);
-    bool result = stepResult == SQLITE_ROW;
-    sqlite3_reset(stmt);
-    sqlite3_finalize(stmt);
-    return result;
+    this->loadKeys();
+    return this->m_knownCheckCodes.count(modd.getCheckCode()) > 0;
 }
 
 /**
@@ -162,17 +257,38 @@ bool Database::contains(const Modd& modd) const {
  * @return true if found in db. false, otherwise.
 */
 bool Database::contains(const Video& video) const {
-    string sqlStr = "SELECT * FROM video WHERE hash == ?";
+    this->loadKeys();
+    return this->m_knownHashes.count(video.getHash()) > 0;
+}
 
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v3(this->m_dbHandle, sqlStr.c_str(), sqlStr.size() + video.getHash().size(), 0, &stmt, nullptr);
-    sqlite3_bind_blob(stmt, 1, video.getHash().data(), video.getHash().size(), SQLITE_TRANSIENT);
+/**
+ * Loads the key of every stored modd and video, one query per table, so existence
+ * checks never need to go back to the database.
+*/
+void Database::loadKeys() const {
+    if (this->m_keysLoaded) return;
 
-    int stepResult = sqlite3_step(stmt);
-    bool result = stepResult == SQLITE_ROW;
-    sqlite3_reset(stmt);
-    sqlite3_finalize(stmt);
-    return result;
+    Cursor modds = this->cursor(MODD_KEYS_STR);
+    while (modds.step()) {
+        this->m_knownCheckCodes.insert(static_cast<uint32_t>(modds.getInt64(0)));
+    }
+
+    Cursor videos = this->cursor(VIDEO_KEYS_STR);
+    while (videos.step()) {
+        Span<const uint8_t> hash = videos.getBlob(0);
+        this->m_knownHashes.emplace(hash.begin(), hash.end());
+    }
+
+    this->m_keysLoaded = true;
+}
+
+/**
+ * Binds a full path, assembled in a buffer reused from one row to the next.
+*/
+void Database::bindPath(sqlite3_stmt *stmt, int index, const InternedPath& path) {
+    this->m_pathBuffer.clear();
+    path.appendTo(this->m_pathBuffer);
+    sqlite3_bind_text(stmt, index, this->m_pathBuffer.c_str(), this->m_pathBuffer.size(), SQLITE_TRANSIENT);
 }
 
 /**
@@ -180,10 +296,7 @@ bool Database::contains(const Video& video) const {
  * @param Modd object to insert
 */
 sqlite3_stmt *Database::addEntry(const Modd& modd){
-    sqlite3_stmt *stmt;
-    if(sqlite3_prepare_v3(this->m_dbHandle, MODD_INS_STR.c_str(), -1, 0, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error(sqlite3_errmsg(this->m_dbHandle));
-    }
+    sqlite3_stmt *stmt = this->prepared(Statement::INSERT_MODD);
 
     // Bind the variables
     sqlite3_bind_int(stmt, 1, modd.getCheckCode());
@@ -191,28 +304,42 @@ sqlite3_stmt *Database::addEntry(const Modd& modd){
     sqlite3_bind_int64(stmt, 3, modd.getDateTimeActual());
     sqlite3_bind_double(stmt, 4, modd.getDuration());
     sqlite3_bind_int64(stmt, 5, modd.getFileSize());
-    sqlite3_bind_text(stmt, 6, modd.getPath().c_str(), modd.getPath().string().length(), SQLITE_TRANSIENT);
+    this->bindPath(stmt, 6, modd.getPath());
 
     return stmt;
 }
 
 void Database::addEntries(const vector<Modd*> modds) {
-    // Check which modds are already in the DB
-    vector<Modd*> appendModds;
-    for (const auto& modd : modds) {
-        if (!this->contains(*modd)) {
-            appendModds.push_back(modd);
-        }
-    }
+    this->loadKeys();
+
     // Start the transaction.
     sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
 
-    for (const auto& modd : appendModds) {
+    vector<uint32_t> added;
+    for (const auto& modd : modds) {
+        // Skips modds already in the DB, as well as repeats within this batch.
+        if (!this->m_knownCheckCodes.insert(modd->getCheckCode()).second) {
+            Stats::global().add(Counter::ROWS_SKIPPED);
+            continue;
+        }
+        added.push_back(modd->getCheckCode());
+
         auto stmt = this->addEntry(*modd);
 
-        sqlite3_step(stmt);
+        int result = sqlite3_step(stmt);
         sqlite3_reset(stmt);
-        sqlite3_finalize(stmt);
+        if (result == SQLITE_BUSY) {
+            sqlite3_exec(this->m_dbHandle, "ROLLBACK", nullptr, nullptr, nullptr);
+            for (const auto& checkCode : added) {
+                this->m_knownCheckCodes.erase(checkCode);
+            }
+            throw std::runtime_error("Failed to acquire db lock.");
+        }
+        if (result != SQLITE_DONE) {
+            // Not stored, so a later batch may still add it.
+            this->m_knownCheckCodes.erase(modd->getCheckCode());
+        }
+        this->countStep(result, Counter::ROWS_INSERTED);
     }
 
     // Commit the transaction.
@@ -224,35 +351,88 @@ void Database::addEntries(const vector<Modd*> modds) {
  * @param video Video object to insert 
 */
 sqlite3_stmt *Database::addEntry(const Video& video){
-    sqlite3_stmt *statement;
-    int result = sqlite3_prepare_v3(this->m_dbHandle, VIDEO_INS_STR.c_str(), VIDEO_INS_STR.size() + 128, 0, &statement, nullptr);
+    sqlite3_stmt *statement = this->prepared(Statement::INSERT_VIDEO);
     sqlite3_bind_blob(statement, 1, video.getHash().data(), video.getHash().size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(statement, 2, video.getName().c_str(), video.getName().size(), SQLITE_TRANSIENT);
     sqlite3_bind_int(statement, 3, video.getLinkedModd()->getCheckCode());
     sqlite3_bind_int64(statement, 4, video.getCreationTime().unixSecs());
     sqlite3_bind_double(statement, 5, video.getDuration());
-    sqlite3_bind_text(statement, 6, video.getLocation().c_str(), video.getLocation().string().size(), SQLITE_TRANSIENT);
+    this->bindPath(statement, 6, video.getLocation());
     sqlite3_bind_int64(statement, 7, video.getLinkedModd()->getFileSize());
+    sqlite3_bind_int(statement, 8, static_cast<int>(video.getHashStrategy()));
+    sqlite3_bind_int(statement, 9, static_cast<int>(video.getContainer()));
+    sqlite3_bind_int(statement, 10, static_cast<int>(video.getVideoCodec()));
+    sqlite3_bind_int(statement, 11, static_cast<int>(video.getAudioCodec()));
+    if (video.getStreamDuration() > 0) {
+        sqlite3_bind_double(statement, 12, video.getStreamDuration());
+    }
     
     return statement;
 }
 
+/**
+ * Looks for a row stored for the video's modd under a different hash, which inserting
+ * the video will replace. Happens when the hash strategy changes or the file is edited.
+ * @param hash set to the replaced row's hash.
+ * @return true if there is such a row.
+*/
+bool Database::replacedHash(const Video& video, Hash& hash) {
+    sqlite3_stmt *stmt = this->prepared(Statement::SELECT_MODD_HASH);
+    sqlite3_bind_int(stmt, 1, video.getLinkedModd()->getCheckCode());
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const uint8_t* data = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+        hash.assign(data, data + sqlite3_column_bytes(stmt, 0));
+        found = hash != video.getHash();
+    }
+    sqlite3_reset(stmt);
+
+    return found;
+}
+
 void Database::updateEntries(const vector<Video*> videos) {
     // Start the transaction.
     sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
 
     int updateCount = 0;
+    vector<Hash> added;
+    vector<Hash> replaced;
     for (const auto& video : videos) {
+        bool known = this->contains(*video);
+        Hash oldHash;
+        bool replacing = !known && this->replacedHash(*video, oldHash);
+        if (replacing) {
+            known = true;
+            this->m_knownHashes.erase(oldHash);
+            replaced.push_back(std::move(oldHash));
+        }
         sqlite3_stmt *stmt = this->updateEntry(*video);
 
-        if (stmt != nullptr) {
+        if (stmt == nullptr) {
+            Stats::global().add(Counter::ROWS_SKIPPED);
+        } else {
             int result = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
             if (result == SQLITE_BUSY) {
                 sqlite3_exec(this->m_dbHandle, "ROLLBACK", nullptr, nullptr, nullptr);
-                sqlite3_finalize(stmt);
+                for (const auto& hash : added) {
+                    this->m_knownHashes.erase(hash);
+                }
+                this->m_knownHashes.insert(replaced.begin(), replaced.end());
                 throw std::runtime_error("Failed to acquire db lock.");
             }
-            sqlite3_finalize(stmt);
+            this->countStep(result, known ? Counter::ROWS_UPDATED : Counter::ROWS_INSERTED);
+            if (result != SQLITE_DONE) {
+                // Not stored, so the row it would have replaced is still there.
+                if (replacing) {
+                    this->m_knownHashes.insert(replaced.back());
+                }
+                continue;
+            }
+            if (this->m_knownHashes.insert(video->getHash()).second) {
+                added.push_back(video->getHash());
+            }
             updateCount++;
         }
     }
@@ -262,82 +442,253 @@ void Database::updateEntries(const vector<Video*> videos) {
     std::clog << updateCount << " updated/added video entries." << std::endl;
 }
 
-sqlite3_stmt *Database::updateEntry(const Video& video) {
-    if (!this->contains(video)) return addEntry(video);
+/**
+ * Compares a stored video with its row. Rows stored before the container, codecs or
+ * stream duration were recorded have them NULL, and always need filling in.
+ * @return true if anything stored about the video has changed.
+*/
+bool Database::needsUpdate(const Video& video) {
+    sqlite3_stmt *stmt = this->prepared(Statement::SELECT_VIDEO);
+    sqlite3_bind_blob(stmt, 1, video.getHash().data(), video.getHash().size(), SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        sqlite3_reset(stmt);
+        throw std::runtime_error("Failed to find matching entry in database.");
+    }
 
-    // First determine what has changed.
-    Video originalVid = this->get(video.getHash());
+    auto text = [stmt](int col) {
+        return std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, col)), sqlite3_column_bytes(stmt, col));
+    };
+    auto differs = [stmt](int col, int value) {
+        return sqlite3_column_type(stmt, col) == SQLITE_NULL || sqlite3_column_int(stmt, col) != value;
+    };
+
+    this->m_pathBuffer.clear();
+    video.getLocation().appendTo(this->m_pathBuffer);
+    bool changed = text(1) != video.getName() ||
+        sqlite3_column_int64(stmt, 3) != video.getCreationTime().unixSecs() ||
+        sqlite3_column_double(stmt, 4) != video.getDuration() ||
+        text(5) != this->m_pathBuffer ||
+        differs(7, static_cast<int>(video.getHashStrategy())) ||
+        differs(8, static_cast<int>(video.getContainer())) ||
+        differs(9, static_cast<int>(video.getVideoCodec())) ||
+        differs(10, static_cast<int>(video.getAudioCodec())) ||
+        (video.getStreamDuration() > 0 && (sqlite3_column_type(stmt, 11) == SQLITE_NULL ||
+            sqlite3_column_double(stmt, 11) != video.getStreamDuration()));
+    sqlite3_reset(stmt);
 
-    std::stringstream execStr;
-    execStr << "UPDATE video SET";
-    bool commaNeeded;
-    bool needsUpdate;
-    if (video.getName() != originalVid.getName()) {
-        execStr << " name = ?2";
-        commaNeeded = true;
-        needsUpdate = true;
-    }
-    if (video.getCreationTime().unixSecs() != originalVid.getCreationTime().unixSecs()) {
-        if (commaNeeded) execStr << ",";
-        execStr << " dateTime = ?3";
-        commaNeeded = true;
-        needsUpdate = true;
-    }
-    if (video.getDuration() != originalVid.getDuration()) {
-        if (commaNeeded) execStr << ",";
-        execStr << " duration = ?4";
-        commaNeeded = true;
-        needsUpdate = true;
-    }
-    if (video.getLocation() != originalVid.getLocation()) {
-        if (commaNeeded) execStr << ",";
-        execStr << " fileLocation = ?5";
-        needsUpdate = true;
-    }
-    execStr << "WHERE hash == ?1";
+    return changed;
+}
 
-    if (needsUpdate) return nullptr;
+sqlite3_stmt *Database::updateEntry(const Video& video) {
+    if (!this->contains(video)) return addEntry(video);
 
-    string str = execStr.str();
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v3(this->m_dbHandle, str.c_str(), -1, 0, &stmt, nullptr);
+    if (!this->needsUpdate(video)) return nullptr;
+
+    sqlite3_stmt *stmt = this->prepared(Statement::UPDATE_VIDEO);
     sqlite3_bind_blob(stmt, 1, video.getHash().data(), video.getHash().size(), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, video.getName().c_str(), video.getName().length(), SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 3, video.getCreationTime().unixSecs());
     sqlite3_bind_double(stmt, 4, video.getDuration());
-    sqlite3_bind_text(stmt, 5, video.getLocation().c_str(), video.getLocation().string().length(), SQLITE_TRANSIENT);
+    this->bindPath(stmt, 5, video.getLocation());
+    sqlite3_bind_int(stmt, 6, static_cast<int>(video.getContainer()));
+    sqlite3_bind_int(stmt, 7, static_cast<int>(video.getVideoCodec()));
+    sqlite3_bind_int(stmt, 8, static_cast<int>(video.getAudioCodec()));
+    // Left NULL when not measured this time, so the stored value is kept.
+    if (video.getStreamDuration() > 0) {
+        sqlite3_bind_double(stmt, 9, video.getStreamDuration());
+    }
+    sqlite3_bind_int(stmt, 10, static_cast<int>(video.getHashStrategy()));
 
     return stmt;
 }
 
 void Database::addEntries(const vector<Video*> videos) {
-    // Check which modds are already in the DB
-    vector<Video*> appendVids;
-    for (const auto& video : videos) {
-        if (!this->contains(*video)) {
-            appendVids.push_back(video);
-        }
-    }
+    this->loadKeys();
+
     // Start the transaction.
     sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
 
-    for (const auto& video : appendVids) {
+    vector<Hash> added;
+    vector<Hash> replaced;
+    for (const auto& video : videos) {
+        // Skips videos already in the DB, as well as repeats within this batch.
+        if (!this->m_knownHashes.insert(video->getHash()).second) {
+            Stats::global().add(Counter::ROWS_SKIPPED);
+            continue;
+        }
+        added.push_back(video->getHash());
+
+        Hash oldHash;
+        bool replacing = this->replacedHash(*video, oldHash);
+        if (replacing) {
+            this->m_knownHashes.erase(oldHash);
+            replaced.push_back(std::move(oldHash));
+        }
+
         sqlite3_stmt *stmt = this->addEntry(*video);
 
         int result = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
         if (result == SQLITE_BUSY) {
             sqlite3_exec(this->m_dbHandle, "ROLLBACK", nullptr, nullptr, nullptr);
-            sqlite3_finalize(stmt);
+            for (const auto& hash : added) {
+                this->m_knownHashes.erase(hash);
+            }
+            this->m_knownHashes.insert(replaced.begin(), replaced.end());
             throw std::runtime_error("Failed to acquire db lock.");
         }
-        sqlite3_reset(stmt);
-        sqlite3_finalize(stmt);
+        if (result != SQLITE_DONE) {
+            // Not stored, so the row it would have replaced is still there.
+            this->m_knownHashes.erase(video->getHash());
+            if (replacing) {
+                this->m_knownHashes.insert(replaced.back());
+            }
+        }
+        this->countStep(result, replacing ? Counter::ROWS_UPDATED : Counter::ROWS_INSERTED);
     }
 
     // Commit the transaction.
     sqlite3_exec(this->m_dbHandle, "COMMIT", nullptr, nullptr, nullptr);
 }
 
+/**
+ * Records the outcome of stepping a row-writing statement.
+ * @param result return value of sqlite3_step.
+ * @param counter counter to bump if the row was written.
+*/
+void Database::countStep(int result, Counter counter) {
+    if (result == SQLITE_DONE) {
+        Stats::global().add(counter);
+    } else {
+        Stats::global().addError(Stage::DB);
+    }
+}
+
+/**
+ * Loads every stored file signature.
+ * @return map of file path to its signature at the time it was last ingested.
+*/
+Signatures Database::getSignatures() {
+    static const string sigSelect = "SELECT path, device, inode, size, mtimeNs FROM fileSignature";
+
+    Signatures signatures;
+    Cursor cursor = this->cursor(sigSelect);
+    while (cursor.step()) {
+        FileSignature sig;
+        sig.device = cursor.getInt64(1);
+        sig.inode = cursor.getInt64(2);
+        sig.size = cursor.getInt64(3);
+        sig.mtimeNs = cursor.getInt64(4);
+        signatures.emplace(cursor.getText(0), sig);
+    }
+
+    return signatures;
+}
+
+/**
+ * Maps each stored modd file location to the location of its video.
+*/
+std::unordered_map<string, string> Database::getVideoLocations() {
+    static const string locSelect =
+        "SELECT modd.moddFileLocation, video.fileLocation FROM modd JOIN video ON video.moddCheckCode = modd.checkCode";
+
+    std::unordered_map<string, string> locations;
+    Cursor cursor = this->cursor(locSelect);
+    while (cursor.step()) {
+        if (!cursor.isNull(0) && !cursor.isNull(1)) {
+            locations.emplace(cursor.getText(0), cursor.getText(1));
+        }
+    }
+
+    return locations;
+}
+
+/**
+ * Loads the hash of every stored video, keyed by the CheckCode of its modd.
+ * Also picks up the size its file had when the hash was taken, where a signature was kept.
+*/
+StoredHashes Database::getStoredHashes() {
+    static const string hashSelect =
+        "SELECT video.moddCheckCode, video.fileSize, video.hash, video.hashStrategy, fileSignature.size "
+        "FROM video LEFT JOIN fileSignature ON fileSignature.path = video.fileLocation";
+
+    StoredHashes hashes;
+    Cursor cursor = this->cursor(hashSelect);
+    while (cursor.step()) {
+        Span<const uint8_t> hash = cursor.getBlob(2);
+        StoredHash stored;
+        stored.hash.assign(hash.begin(), hash.end());
+        stored.strategy = static_cast<HashStrategy>(cursor.getInt64(3));
+        stored.moddFileSize = cursor.getInt64(1);
+        stored.hasVideoSize = !cursor.isNull(4);
+        stored.videoSize = stored.hasVideoSize ? cursor.getInt64(4) : 0;
+        hashes.emplace(static_cast<uint32_t>(cursor.getInt64(0)), std::move(stored));
+    }
+
+    return hashes;
+}
+
+/**
+ * Records the signatures of freshly ingested files, replacing any older ones.
+ * @param signatures file paths paired with their current signatures.
+*/
+void Database::updateSignatures(const SignatureList& signatures) {
+    sqlite3_stmt *stmt = this->prepared(Statement::UPSERT_SIGNATURE);
+
+    sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+
+    for (const auto& entry : signatures) {
+        const string& path = entry.first.native();
+        sqlite3_bind_text(stmt, 1, path.c_str(), path.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, entry.second.device);
+        sqlite3_bind_int64(stmt, 3, entry.second.inode);
+        sqlite3_bind_int64(stmt, 4, entry.second.size);
+        sqlite3_bind_int64(stmt, 5, entry.second.mtimeNs);
+
+        int result = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (result == SQLITE_BUSY) {
+            sqlite3_exec(this->m_dbHandle, "ROLLBACK", nullptr, nullptr, nullptr);
+            throw std::runtime_error("Failed to acquire db lock.");
+        }
+    }
+
+    sqlite3_exec(this->m_dbHandle, "COMMIT", nullptr, nullptr, nullptr);
+}
+
+/**
+ * Points every row stored for a moved file at its new path, in one transaction.
+ * Rows already at the new path are left alone, so replaying moves is harmless.
+ * Moves never overwrite a file, so any other modd or signature row claiming the new
+ * path was stale, and is replaced by the moved file's.
+ * @param moves old paths paired with the paths the files now live at.
+*/
+void Database::updateLocations(const MoveList& moves) {
+    static const Statement MOVES[] = {Statement::MOVE_VIDEO, Statement::MOVE_MODD, Statement::MOVE_SIGNATURE};
+
+    sqlite3_exec(this->m_dbHandle, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+
+    for (const auto& move : moves) {
+        const string& from = move.first.native();
+        const string& to = move.second.native();
+        for (Statement statement : MOVES) {
+            sqlite3_stmt *stmt = this->prepared(statement);
+            sqlite3_bind_text(stmt, 1, from.c_str(), from.length(), SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, to.c_str(), to.length(), SQLITE_STATIC);
+
+            int result = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (result != SQLITE_DONE) {
+                string message = sqlite3_errmsg(this->m_dbHandle);
+                sqlite3_exec(this->m_dbHandle, "ROLLBACK", nullptr, nullptr, nullptr);
+                throw std::runtime_error("Failed to update file locations: " + message);
+            }
+        }
+    }
+
+    sqlite3_exec(this->m_dbHandle, "COMMIT", nullptr, nullptr, nullptr);
+}
+
 void Database::sqliteError(const int& errCode) {
     if (errCode != SQLITE_OK || errCode != SQLITE_DONE) {
         std::stringstream errStr;
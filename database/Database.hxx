@@ -5,6 +5,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 extern "C" {
 #include <sqlite3.h>
@@ -12,6 +15,10 @@ extern "C" {
 
 #include "../metadata/Modd.hxx"
 #include "../metadata/Video.hxx"
+#include "../metadata/FileSignature.hxx"
+#include "../stats/Stats.hxx"
+#include "DatabaseProfile.hxx"
+#include "Cursor.hxx"
 
 namespace fs = std::filesystem;
 using std::string;
@@ -23,20 +30,84 @@ namespace memory_replay {
     "CREATE TABLE IF NOT EXISTS modd (checkCode INTEGER UNIQUE, name TEXT, dateTime INTEGER, videoDuration REAL, videoFileSize INTEGER, moddFileLocation TEXT UNIQUE, PRIMARY KEY(checkCode))";
     static const string PREPARE_VIDEO_TABLE = 
     "CREATE TABLE IF NOT EXISTS video (hash BLOB PRIMARY KEY UNIQUE, name TEXT, moddCheckCode TEXT UNIQUE, dateTime INTEGER, duration REAL, fileLocation TEXT, fileSize INTEGER, FOREIGN KEY(moddCheckCode) REFERENCES modd(checkCode))";
+    static const string PREPARE_SIGNATURE_TABLE =
+    "CREATE TABLE IF NOT EXISTS fileSignature (path TEXT PRIMARY KEY, device INTEGER, inode INTEGER, size INTEGER, mtimeNs INTEGER)";
+
+    /**
+     * Schema changes applied in order on top of the tables above. The database's
+     * user_version records how many have been applied, so only ever append to this list.
+    */
+    static const string MIGRATIONS[] = {
+        // 1: Record which fingerprint strategy produced each video hash.
+        "ALTER TABLE video ADD COLUMN hashStrategy INTEGER NOT NULL DEFAULT 0",
+        // 2-4: Date-range and location lookups.
+        "CREATE INDEX IF NOT EXISTS moddDateTime ON modd (dateTime)",
+        "CREATE INDEX IF NOT EXISTS videoDateTime ON video (dateTime)",
+        "CREATE INDEX IF NOT EXISTS videoFileLocation ON video (fileLocation)",
+        // 5-7: Container and codecs, NULL for rows stored before they were recorded.
+        "ALTER TABLE video ADD COLUMN container INTEGER",
+        "ALTER TABLE video ADD COLUMN videoCodec INTEGER",
+        "ALTER TABLE video ADD COLUMN audioCodec INTEGER",
+        // 8: Duration measured from the stream itself, NULL where it couldn't be.
+        "ALTER TABLE video ADD COLUMN streamDuration REAL"
+    };
 
     // USE WITH BOOST::FORMAT
     static const string MODD_INS_STR = "INSERT INTO \"modd\" (checkCode, name, dateTime, videoDuration, videoFileSize, moddFileLocation) VALUES (?, ?, ?, ?, ?, ?)";
-    static const string VIDEO_INS_STR = "INSERT INTO \"video\" (hash, name, moddCheckCode, dateTime, duration, fileLocation, fileSize) VALUES (?, ?, ?, ?, ?, ?, ?)";
+    // Replaces the row of a modd whose video has been stored before under another hash.
+    static const string VIDEO_INS_STR = "INSERT OR REPLACE INTO \"video\" (hash, name, moddCheckCode, dateTime, duration, fileLocation, fileSize, hashStrategy, container, videoCodec, audioCodec, streamDuration) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    static const string SIGNATURE_UPSERT_STR = "INSERT OR REPLACE INTO \"fileSignature\" (path, device, inode, size, mtimeNs) VALUES (?, ?, ?, ?, ?)";
+    static const string MODD_KEYS_STR = "SELECT checkCode FROM modd";
+    static const string VIDEO_KEYS_STR = "SELECT hash FROM video";
+    static const string VIDEO_SELECT_STR = "SELECT * FROM video WHERE hash == ?";
+    static const string VIDEO_MODD_HASH_STR = "SELECT hash FROM video WHERE moddCheckCode == ?";
+    static const string VIDEO_MOVE_STR = "UPDATE video SET fileLocation = ?2 WHERE fileLocation == ?1";
+    static const string MODD_MOVE_STR = "UPDATE OR REPLACE modd SET moddFileLocation = ?2 WHERE moddFileLocation == ?1";
+    static const string SIGNATURE_MOVE_STR = "UPDATE OR REPLACE fileSignature SET path = ?2 WHERE path == ?1";
+    static const string VIDEO_UPDATE_STR = "UPDATE video SET name = ?2, dateTime = ?3, duration = ?4, fileLocation = ?5, container = ?6, videoCodec = ?7, audioCodec = ?8, streamDuration = COALESCE(?9, streamDuration), hashStrategy = ?10 WHERE hash == ?1";
+
+    /**
+     * Statements kept prepared for the lifetime of a Database.
+    */
+    enum class Statement {
+        INSERT_MODD,
+        INSERT_VIDEO,
+        SELECT_VIDEO,
+        SELECT_MODD_HASH,
+        UPDATE_VIDEO,
+        UPSERT_SIGNATURE,
+        MOVE_VIDEO,
+        MOVE_MODD,
+        MOVE_SIGNATURE,
+        COUNT           // Number of cached statements. Not a statement.
+    };
 
     typedef map<string, string> Row;    // Wraps a map of strings in a Row type.
     typedef vector<Row> Rows;      // Wraps a vector of Row(s) into a Rows type.
 
+    typedef std::unordered_map<string, FileSignature> Signatures;     // Keyed by file path.
+    typedef vector<std::pair<fs::path, FileSignature>> SignatureList;
+    typedef vector<std::pair<fs::path, fs::path>> MoveList;           // (from, to) file paths.
+
+    /**
+     * What is stored about a video row, for deciding whether its file needs hashing again.
+    */
+    struct StoredHash {
+        Hash            hash;
+        HashStrategy    strategy;
+        uint64_t        moddFileSize;   // FileSize of the modd it was stored with
+        uint64_t        videoSize;      // Size of the file when it was hashed, if known
+        bool            hasVideoSize;
+    };
+    typedef std::unordered_map<uint32_t, StoredHash> StoredHashes;    // Keyed by modd CheckCode.
+
     class Database {
     public:
-        explicit Database(fs::path dbPath);
+        explicit Database(fs::path dbPath, const DatabaseProfile& profile = SAFE_PROFILE);
         ~Database();
 
         Rows query(const string& stmt);
+        Cursor cursor(const string& sql) const;
 
         Video   get(Hash hash);
         Modd    get(uint32_t checkCode);
@@ -48,18 +119,40 @@ namespace memory_replay {
 
         bool contains(const Modd& modd) const;
         bool contains(const Video& video) const;
+
+        Signatures getSignatures();
+        std::unordered_map<string, string> getVideoLocations();
+        StoredHashes getStoredHashes();
+        void updateSignatures(const SignatureList& signatures);
+        void updateLocations(const MoveList& moves);
     private:
         sqlite3 *m_dbHandle;
+        mutable sqlite3_stmt *m_statements[static_cast<std::size_t>(Statement::COUNT)];
+
+        // Keys of every row already stored, loaded on first use and kept in step with inserts.
+        mutable bool                                    m_keysLoaded;
+        mutable std::unordered_set<uint32_t>            m_knownCheckCodes;
+        mutable std::unordered_set<Hash, HashHasher>    m_knownHashes;
+
+        string m_pathBuffer;    // Reused to bind interned paths, which aren't stored whole
+
+        sqlite3_stmt *prepared(Statement statement) const;
+        void loadKeys() const;
 
+        void bindPath(sqlite3_stmt *stmt, int index, const InternedPath& path);
         sqlite3_stmt *addEntry(const Modd& modd);
         sqlite3_stmt *addEntry(const Video& video);
+        bool replacedHash(const Video& video, Hash& hash);
 
         sqlite3_stmt *updateEntry(const Modd& modd);
+        bool needsUpdate(const Video& video);
         sqlite3_stmt *updateEntry(const Video& video);
 
+        void applyProfile(const DatabaseProfile& profile);
+        void migrate();
+        static void countStep(int result, Counter counter);
         void sqliteError(const int& errCode);
         int execStatement(string statement, unsigned int flags);
-        static int handleQuery(void* rows, int numCols, char** colVals, char** colNames);
     };
 };
 
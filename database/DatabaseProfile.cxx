@@ -0,0 +1,14 @@
+#include "DatabaseProfile.hxx"
+
+using namespace memory_replay;
+
+bool DatabaseProfile::parse(const std::string& name, DatabaseProfile& profile) {
+    if (name == "safe") {
+        profile = SAFE_PROFILE;
+    } else if (name == "fast") {
+        profile = FAST_PROFILE;
+    } else {
+        return false;
+    }
+    return true;
+}
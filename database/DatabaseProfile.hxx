@@ -0,0 +1,36 @@
+#ifndef MEMORY_REPLAY_DATABASE_PROFILE_HXX
+#define MEMORY_REPLAY_DATABASE_PROFILE_HXX
+
+#include <cstdint>
+#include <string>
+
+namespace memory_replay {
+    /**
+     * Connection settings applied when a Database is opened.
+    */
+    struct DatabaseProfile {
+        bool        wal;                // Write-ahead log instead of a rollback journal
+        bool        syncNormal;         // synchronous=NORMAL rather than FULL
+        int64_t     mmapSize;           // Bytes of the file read through mmap. 0 disables it
+        int         cacheSize;          // Page cache size. Negative values are in KiB
+        bool        tempStoreMemory;    // Keep temporary tables and indices in memory
+        int         busyTimeoutMs;      // How long to wait on a lock held by another connection
+
+        /**
+         * Looks up a named profile.
+         * @param name "safe" or "fast".
+         * @param profile receives the matching profile.
+         * @return false if the name is unknown.
+        */
+        static bool parse(const std::string& name, DatabaseProfile& profile);
+    };
+
+    // SQLite's own defaults. Every commit is fully synced and readers block the writer.
+    static const DatabaseProfile SAFE_PROFILE = {false, false, 0, -2000, false, 0};
+
+    // WAL lets other connections read the catalog while an ingest is writing. With
+    // synchronous=NORMAL a power loss can drop the last commits but never corrupts the file.
+    static const DatabaseProfile FAST_PROFILE = {true, true, 268435456, -65536, true, 5000};
+};
+
+#endif // MEMORY_REPLAY_DATABASE_PROFILE_HXX
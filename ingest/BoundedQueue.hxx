@@ -0,0 +1,105 @@
+#ifndef MEMORY_REPLAY_BOUNDED_QUEUE_HXX
+#define MEMORY_REPLAY_BOUNDED_QUEUE_HXX
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace memory_replay {
+    /**
+     * Fixed-capacity FIFO shared between pipeline stages.
+     * Producers block while the queue is full and consumers block while it is empty,
+     * so a slow stage applies back-pressure instead of letting work pile up in memory.
+     */
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {};
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        /**
+         * Appends an item, waiting for room if the queue is full.
+         * @param item value to append.
+         * @return false if the queue was closed before the item could be added.
+        */
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            this->m_notFull.wait(lock, [this] { return this->m_closed || this->m_items.size() < this->m_capacity; });
+            if (this->m_closed) {
+                return false;
+            }
+            this->m_items.push_back(std::move(item));
+            lock.unlock();
+            this->m_notEmpty.notify_one();
+            return true;
+        };
+
+        /**
+         * Removes the oldest item, waiting for one to arrive if the queue is empty.
+         * @param item receives the removed value.
+         * @return false once the queue is closed and fully drained.
+        */
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            this->m_notEmpty.wait(lock, [this] { return this->m_closed || !this->m_items.empty(); });
+            if (this->m_items.empty()) {
+                return false;
+            }
+            item = std::move(this->m_items.front());
+            this->m_items.pop_front();
+            lock.unlock();
+            this->m_notFull.notify_one();
+            return true;
+        };
+
+        /**
+         * Removes the oldest item if there is one, without waiting.
+         * @param item receives the removed value.
+         * @return false if the queue is empty.
+        */
+        bool tryPop(T& item) {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            if (this->m_items.empty()) {
+                return false;
+            }
+            item = std::move(this->m_items.front());
+            this->m_items.pop_front();
+            lock.unlock();
+            this->m_notFull.notify_one();
+            return true;
+        };
+
+        /**
+         * @return true once the queue is closed and fully drained.
+        */
+        bool drained() {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            return this->m_closed && this->m_items.empty();
+        };
+
+        /**
+         * Stops accepting new items and wakes every waiting producer and consumer.
+         * Items already queued can still be popped.
+        */
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(this->m_mutex);
+                this->m_closed = true;
+            }
+            this->m_notFull.notify_all();
+            this->m_notEmpty.notify_all();
+        };
+    private:
+        std::mutex              m_mutex;
+        std::condition_variable m_notFull;
+        std::condition_variable m_notEmpty;
+        std::deque<T>           m_items;
+        std::size_t             m_capacity;
+        bool                    m_closed;
+    };
+};
+
+#endif // MEMORY_REPLAY_BOUNDED_QUEUE_HXX
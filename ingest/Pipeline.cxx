@@ -0,0 +1,424 @@
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "Pipeline.hxx"
+#include "../metadata/BatchHasher.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+Pipeline::Pipeline(Database& db, const PipelineOptions& options) :
+    m_db(db), m_options(options), m_skipped(0) {
+    if (this->m_options.workers == 0) {
+        this->m_options.workers = 1;
+    }
+    if (this->m_options.ioThreads == 0) {
+        this->m_options.ioThreads = 1;
+    }
+}
+
+/**
+ * Runs every stage to completion.
+ *
+ * @param searchDir root of the directory tree to search for .modd files.
+ * @param onCommit called with each batch of clips after it has been committed.
+*/
+void Pipeline::run(const fs::path& searchDir, const BatchHandler& onCommit) {
+    this->runStages([this, &searchDir](BoundedQueue<ScanItem>& items) {
+        this->scan(searchDir, items);
+    }, onCommit);
+}
+
+/**
+ * Ingests a known set of clips instead of scanning for them.
+ *
+ * @param items the .modd files to ingest, each with its video if there is one.
+ * @param onCommit called with each batch of clips after it has been committed.
+*/
+void Pipeline::run(const vector<ScanItem>& items, const BatchHandler& onCommit) {
+    this->runStages([&items](BoundedQueue<ScanItem>& queue) {
+        for (const auto& item : items) {
+            if (!queue.push(item)) {
+                return;
+            }
+        }
+    }, onCommit);
+}
+
+/**
+ * Loads what the workers check clips against. Workers only read these, so they are
+ * reloaded before every run, while nothing else uses the db. That way a watch run
+ * sees the clips earlier runs committed and wherever they were relocated to.
+*/
+void Pipeline::loadIndexes() {
+    if (this->m_options.incremental) {
+        this->m_knownSignatures = this->m_db.getSignatures();
+        this->m_knownVideos = this->m_db.getVideoLocations();
+    }
+    this->m_storedHashes = this->m_db.getStoredHashes();
+}
+
+/**
+ * Starts the source, worker and writer stages and waits for all of them to finish.
+*/
+void Pipeline::runStages(const Source& source, const BatchHandler& onCommit) {
+    this->loadIndexes();
+    this->m_skipped = 0;
+
+    BoundedQueue<ScanItem> items(this->m_options.queueDepth);
+    BoundedQueue<Clip> unhashed(this->m_options.queueDepth);
+    BoundedQueue<Clip> clips(this->m_options.queueDepth);
+
+    std::mutex errMutex;
+    std::exception_ptr error;
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errMutex);
+        if (!error) error = e;
+        // Unblock every other stage so the pipeline can wind down.
+        items.close();
+        unhashed.close();
+        clips.close();
+    };
+
+    std::thread scanner([&] {
+        try {
+            source(items);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        items.close();
+    });
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < this->m_options.workers; i++) {
+        workers.emplace_back([&] {
+            try {
+                this->parse(items, unhashed, clips);
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        });
+    }
+
+    std::vector<std::thread> hashers;
+    if (this->m_options.ioEngine != IoEngine::INLINE) {
+        for (unsigned int i = 0; i < this->m_options.ioThreads; i++) {
+            hashers.emplace_back([&] {
+                try {
+                    this->hash(unhashed, clips);
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+            });
+        }
+    }
+
+    std::thread writer([&] {
+        try {
+            this->write(clips, onCommit);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    scanner.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    unhashed.close();
+    for (auto& hasher : hashers) {
+        hasher.join();
+    }
+    clips.close();
+    writer.join();
+
+    // Anything left behind after a failure still needs to be freed.
+    Clip clip;
+    while (unhashed.pop(clip)) {
+    }
+    while (clips.pop(clip)) {
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    if (this->m_options.incremental) {
+        std::clog << this->m_skipped << " unchanged clips skipped." << std::endl;
+    }
+}
+
+/**
+ * Scanner stage. Walks the search directory and queues every .modd file found
+ * along with its video.
+*/
+void Pipeline::scan(const fs::path& searchDir, BoundedQueue<ScanItem>& items) {
+    Scanner::scan(searchDir, [&items](ScanItem&& item) {
+        return items.push(std::move(item));
+    }, this->m_options.workers);
+}
+
+/**
+ * Worker stage. Parses each queued .modd and builds its Video. Videos are hashed here
+ * when hashing inline, otherwise ones without a usable stored hash go to the hash stage.
+*/
+void Pipeline::parse(BoundedQueue<ScanItem>& items, BoundedQueue<Clip>& unhashed, BoundedQueue<Clip>& clips) {
+    bool hashInline = this->m_options.ioEngine == IoEngine::INLINE;
+    ScanItem item;
+    while (items.pop(item)) {
+        const fs::path& moddPath = item.modd;
+        Clip clip;
+        clip.hasVideoSignature = false;
+        clip.unchanged = false;
+        clip.hasModdSignature = FileSignature::read(moddPath, clip.moddSignature);
+        if (this->m_options.incremental && clip.hasModdSignature && this->isUnchanged(moddPath, clip.moddSignature)) {
+            this->m_skipped++;
+            if (this->m_options.keepUnchanged && !this->passUnchanged(item, clips)) {
+                return;
+            }
+            continue;
+        }
+
+        try {
+            ScopedTimer timer(Stage::PARSE);
+            clip.modd.reset(new Modd(moddPath));
+            Stats::global().addItems(Stage::PARSE);
+        } catch (const std::exception& e) {
+            Stats::global().addError(Stage::PARSE);
+            std::cerr << e.what() << ": " << moddPath << std::endl;
+            continue;
+        }
+
+        bool needsHash = false;
+        if (item.video.empty()) {
+            std::cerr << "No video found for " << moddPath << std::endl;
+        } else {
+            clip.hasVideoSignature = FileSignature::read(item.video, clip.videoSignature);
+            const StoredHash* stored = this->storedHash(clip);
+            if (stored != nullptr) {
+                clip.video.reset(new Video(*clip.modd, item.video, stored->hash, stored->strategy));
+                Stats::global().add(Counter::HASHES_REUSED);
+            } else if (!hashInline) {
+                clip.video.reset(new Video(*clip.modd, item.video, this->m_options.hashStrategy, false));
+                needsHash = true;
+            } else {
+                ScopedTimer timer(Stage::HASH);
+                clip.video.reset(new Video(*clip.modd, item.video, this->m_options.hashStrategy));
+                if (clip.video->getHash().empty()) {
+                    // Already reported by Video. Storing it would leave an empty-hash row.
+                    clip.video.reset();
+                    clip.hasVideoSignature = false;
+                } else {
+                    Stats::global().addItems(Stage::HASH);
+                }
+            }
+        }
+
+        if (!(needsHash ? unhashed : clips).push(std::move(clip))) {
+            return;
+        }
+    }
+}
+
+/**
+ * Hands an unchanged clip straight to the writer, which passes it on to the batch handler
+ * without storing it. Only the modd is parsed; the video is neither probed nor hashed.
+ * @return false if the writer has stopped taking clips.
+*/
+bool Pipeline::passUnchanged(const ScanItem& item, BoundedQueue<Clip>& clips) {
+    Clip clip;
+    clip.hasModdSignature = false;
+    clip.hasVideoSignature = false;
+    clip.unchanged = true;
+    try {
+        clip.modd.reset(new Modd(item.modd));
+    } catch (const std::exception& e) {
+        Stats::global().addError(Stage::PARSE);
+        std::cerr << e.what() << ": " << item.modd << std::endl;
+        return true;
+    }
+
+    auto videoLoc = this->m_knownVideos.find(item.modd.native());
+    if (videoLoc != this->m_knownVideos.end()) {
+        clip.video.reset(new Video(fs::path(videoLoc->second), clip.modd->getDateTimeActual(), clip.modd->getDuration(), Hash()));
+    }
+    return clips.push(std::move(clip));
+}
+
+/**
+ * Hash stage. Keeps as many queued videos hashing at once as its BatchHasher allows,
+ * taking more from the workers whenever a slot frees up, and passes each clip on to
+ * the writer as soon as its hash is done and its stream duration measured.
+*/
+void Pipeline::hash(BoundedQueue<Clip>& unhashed, BoundedQueue<Clip>& clips) {
+    auto engine = ReadEngine::create(this->m_options.ioEngine, this->m_options.ioDepth, this->m_options.ioBuffers);
+    BatchHasher hasher(*engine);
+    std::unordered_map<uint64_t, Clip> hashing;
+    uint64_t nextTag = 0;
+    bool moreInput = true;
+
+    while (true) {
+        while (moreInput && hasher.canStart()) {
+            // Only block for more work when there's nothing else to wait on.
+            Clip clip;
+            bool popped = hasher.idle() ? unhashed.pop(clip) : unhashed.tryPop(clip);
+            if (!popped) {
+                moreInput = !hasher.idle() && !unhashed.drained();
+                break;
+            }
+            hasher.start(clip.video->getLocation().path(), this->m_options.hashStrategy, nextTag);
+            hashing.emplace(nextTag++, std::move(clip));
+        }
+
+        if (hasher.idle()) {
+            if (!moreInput) return;
+            continue;
+        }
+
+        Hash hash;
+        bool ok;
+        uint64_t tag;
+        {
+            ScopedTimer timer(Stage::HASH);
+            tag = hasher.next(hash, ok);
+        }
+
+        auto done = hashing.find(tag);
+        Clip clip = std::move(done->second);
+        hashing.erase(done);
+        if (ok) {
+            clip.video->setHash(std::move(hash));
+            Stats::global().addItems(Stage::HASH);
+            // Off the parse threads, while the hasher's other reads are still in flight.
+            clip.video->measureDuration(clip.video->getLocation().path());
+        } else {
+            Stats::global().addError(Stage::HASH);
+            std::cerr << "Failed to read video file: " << clip.video->getLocation() << std::endl;
+            // Only the modd is stored, and without the video's signature it is retried next run.
+            clip.video.reset();
+            clip.hasVideoSignature = false;
+        }
+
+        if (!clips.push(std::move(clip))) {
+            return;
+        }
+    }
+}
+
+/**
+ * Checks a .modd file and the video recorded for it against their stored signatures.
+ * @return true if neither file has changed since it was last ingested.
+*/
+bool Pipeline::isUnchanged(const fs::path& moddPath, const FileSignature& moddSignature) const {
+    auto storedModd = this->m_knownSignatures.find(moddPath.native());
+    if (storedModd == this->m_knownSignatures.end() || storedModd->second != moddSignature) {
+        return false;
+    }
+
+    auto videoLoc = this->m_knownVideos.find(moddPath.native());
+    if (videoLoc == this->m_knownVideos.end()) {
+        return false;
+    }
+
+    auto storedVideo = this->m_knownSignatures.find(videoLoc->second);
+    FileSignature videoSignature;
+    return storedVideo != this->m_knownSignatures.end() &&
+        FileSignature::read(videoLoc->second, videoSignature) && storedVideo->second == videoSignature;
+}
+
+/**
+ * Looks for a stored hash that still describes a clip's video.
+ *
+ * The stored row has to belong to a modd with the same CheckCode and FileSize, and the
+ * video must still be the size it was when hashed. Where that size wasn't recorded, it
+ * must match the FileSize the modd gives for it. The hash itself must be non-empty and
+ * made with the strategy this run hashes with; LEGACY hashes are never reused, since
+ * they covered whatever the read buffer held past the end of short reads.
+ *
+ * @return the stored hash, or nullptr if the video needs hashing.
+*/
+const StoredHash* Pipeline::storedHash(const Clip& clip) const {
+    if (!clip.hasVideoSignature) {
+        return nullptr;
+    }
+
+    auto stored = this->m_storedHashes.find(clip.modd->getCheckCode());
+    if (stored == this->m_storedHashes.end() || stored->second.moddFileSize != clip.modd->getFileSize()) {
+        return nullptr;
+    }
+    if (stored->second.hash.empty() || stored->second.strategy == HashStrategy::LEGACY ||
+        stored->second.strategy != this->m_options.hashStrategy) {
+        return nullptr;
+    }
+
+    uint64_t expectedSize = stored->second.hasVideoSize ? stored->second.videoSize : clip.modd->getFileSize();
+    return clip.videoSignature.size == expectedSize ? &stored->second : nullptr;
+}
+
+/**
+ * Writer stage. The only thread that touches the database; commits clips in batches.
+*/
+void Pipeline::write(BoundedQueue<Clip>& clips, const BatchHandler& onCommit) {
+    vector<Clip> batch;
+    batch.reserve(this->m_options.batchSize);
+
+    Clip clip;
+    while (clips.pop(clip)) {
+        batch.push_back(std::move(clip));
+
+        if (batch.size() >= this->m_options.batchSize) {
+            this->commit(batch);
+            onCommit(batch);
+            batch.clear();
+        }
+    }
+
+    if (!batch.empty()) {
+        this->commit(batch);
+        onCommit(batch);
+        batch.clear();
+    }
+}
+
+/**
+ * Stores one batch of clips along with the signatures of their files.
+*/
+void Pipeline::commit(const vector<Clip>& batch) {
+    vector<Modd*> batchModds;
+    vector<Video*> batchVideos;
+    SignatureList signatures;
+    batchModds.reserve(batch.size());
+    batchVideos.reserve(batch.size());
+    signatures.reserve(batch.size() * 2);
+
+    std::size_t stored = 0;
+    for (const auto& clip : batch) {
+        if (clip.unchanged) {
+            continue;
+        }
+        stored++;
+        batchModds.push_back(clip.modd.get());
+        if (clip.video) {
+            batchVideos.push_back(clip.video.get());
+        }
+        if (clip.hasModdSignature) {
+            signatures.emplace_back(clip.modd->getPath().path(), clip.moddSignature);
+        }
+        if (clip.hasVideoSignature) {
+            signatures.emplace_back(clip.video->getLocation().path(), clip.videoSignature);
+        }
+    }
+
+    ScopedTimer timer(Stage::DB);
+    try {
+        this->m_db.addEntries(batchModds);
+        this->m_db.updateEntries(batchVideos);
+        this->m_db.updateSignatures(signatures);
+    } catch (...) {
+        Stats::global().addError(Stage::DB);
+        throw;
+    }
+    Stats::global().addItems(Stage::DB, stored);
+}
@@ -0,0 +1,117 @@
+#ifndef MEMORY_REPLAY_PIPELINE_HXX
+#define MEMORY_REPLAY_PIPELINE_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../metadata/Modd.hxx"
+#include "../metadata/Video.hxx"
+#include "../metadata/FileSignature.hxx"
+#include "../metadata/ReadEngine.hxx"
+#include "../database/Database.hxx"
+#include "BoundedQueue.hxx"
+#include "Scanner.hxx"
+
+namespace fs = std::filesystem;
+using std::vector;
+
+namespace memory_replay {
+    static const std::size_t DEFAULT_QUEUE_DEPTH = 256;    // Items buffered between two stages
+    static const std::size_t DEFAULT_BATCH_SIZE = 512;     // Rows written per DB transaction
+    static const unsigned int DEFAULT_IO_THREADS = 2;       // Hashing threads when not hashing inline
+
+    struct PipelineOptions {
+        unsigned int    workers;        // Threads parsing modds and hashing videos
+        std::size_t     queueDepth;     // Capacity of each inter-stage queue
+        std::size_t     batchSize;      // Clips committed per transaction by the writer
+        bool            incremental;    // Skip clips whose files are unchanged since the last run
+        bool            keepUnchanged;  // Still hand skipped clips to the batch handler, e.g. to relocate them
+        HashStrategy    hashStrategy;   // Parts of each video covered by its hash
+        IoEngine        ioEngine;       // How videos are read for hashing
+        unsigned int    ioThreads;      // Hashing threads, each with its own engine. Unused when inline
+        unsigned int    ioDepth;        // Reads in flight per engine
+        unsigned int    ioBuffers;      // IO_BUFFER_SIZE buffers per engine
+    };
+
+    /**
+     * A parsed .modd file and the video it describes. video is null if no video was found.
+    */
+    struct Clip {
+        std::unique_ptr<Modd>   modd;
+        std::unique_ptr<Video>  video;
+        FileSignature           moddSignature;
+        FileSignature           videoSignature;
+        bool                    hasModdSignature;
+        bool                    hasVideoSignature;
+        bool                    unchanged;      // Already stored as it is. Passed through without being written
+    };
+
+    /**
+     * Receives each batch of clips on the writer thread once it has been committed.
+     * Clips left in the batch are freed when the handler returns.
+    */
+    typedef std::function<void(vector<Clip>& batch)> BatchHandler;
+
+    /**
+     * Staged ingest for `-u` updates.
+     *
+     * One thread walks the search directory, a pool of workers parses each .modd and
+     * hashes its video, and a single writer thread commits the results to the database
+     * in batches. Stages are joined by bounded queues so disk and CPU work overlap.
+     *
+     * Unless the IoEngine is INLINE, workers leave hashing to a separate stage of
+     * ioThreads threads. Each feeds a BatchHasher, keeping reads for many videos in flight
+     * at once, so hashing is bound by the device's bandwidth rather than per-file latency.
+     *
+     * The stat signature of every ingested file is stored alongside it. In incremental
+     * mode a clip whose .modd and video signatures both still match is skipped without
+     * being hashed, probed or written. With keepUnchanged it still reaches the batch
+     * handler, carrying only its parsed modd and its video's path. Otherwise a video whose modd matches a stored row by
+     * CheckCode and FileSize, and whose size hasn't changed, reuses the stored hash
+     * instead of being read again, so moved files only have their location updated.
+     *
+     * Clips are owned by the pipeline until their batch has been handed to the caller,
+     * so memory use is bounded by the queue depths and batch size, not the library size.
+    */
+    class Pipeline {
+    public:
+        Pipeline(Database& db, const PipelineOptions& options);
+
+        void run(const fs::path& searchDir, const BatchHandler& onCommit);
+        void run(const vector<ScanItem>& items, const BatchHandler& onCommit);
+    private:
+        /**
+         * Feeds the worker stage. Runs on its own thread.
+        */
+        typedef std::function<void(BoundedQueue<ScanItem>& items)> Source;
+
+        Database&           m_db;
+        PipelineOptions     m_options;
+
+        Signatures                          m_knownSignatures;  // Loaded before each incremental run
+        StoredHashes                        m_storedHashes;     // Loaded before each run
+        std::unordered_map<string, string>  m_knownVideos;      // Modd location to video location
+        std::atomic<std::size_t>            m_skipped;
+
+        void runStages(const Source& source, const BatchHandler& onCommit);
+        void loadIndexes();
+
+        void scan(const fs::path& searchDir, BoundedQueue<ScanItem>& items);
+        void parse(BoundedQueue<ScanItem>& items, BoundedQueue<Clip>& unhashed, BoundedQueue<Clip>& clips);
+        void hash(BoundedQueue<Clip>& unhashed, BoundedQueue<Clip>& clips);
+        void write(BoundedQueue<Clip>& clips, const BatchHandler& onCommit);
+
+        bool isUnchanged(const fs::path& moddPath, const FileSignature& moddSignature) const;
+        bool passUnchanged(const ScanItem& item, BoundedQueue<Clip>& clips);
+        const StoredHash* storedHash(const Clip& clip) const;
+        void commit(const vector<Clip>& batch);
+    };
+};
+
+#endif // MEMORY_REPLAY_PIPELINE_HXX
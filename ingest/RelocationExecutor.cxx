@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+};
+
+#include "RelocationExecutor.hxx"
+#include "RelocationJournal.hxx"
+#include "BoundedQueue.hxx"
+#include "../metadata/Relocator.hxx"
+
+using namespace memory_replay;
+
+/**
+ * A move that has finished and is waiting for the committer.
+*/
+struct Completion {
+    uint64_t            id;         // Journal id
+    fs::path            from;
+    fs::path            to;
+    bool                first;      // First move of its task
+    RelocationResult    result;
+};
+
+/**
+ * Directory holding a path's entry. Relative paths without one are in the working directory.
+*/
+static fs::path entryDir(const fs::path& path) {
+    fs::path dir = path.parent_path();
+    return dir.empty() ? fs::path(".") : dir;
+}
+
+/**
+ * Flushes a directory's entries to disk, making renames and creations in it durable.
+ * @throws std::runtime_error on failure.
+*/
+static void syncDirectory(const fs::path& dir) {
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || fsync(fd) != 0) {
+        int err = errno;
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("Failed to sync directory " + dir.string() + ": " + std::strerror(err));
+    }
+    close(fd);
+}
+
+/**
+ * Creates a directory and any missing parents, and syncs the entry of each one created
+ * so files moved into it can't be lost with it.
+ * @throws fs::filesystem_error or std::runtime_error on failure.
+*/
+static void createDirectory(const fs::path& dir) {
+    fs::path existing = dir;
+    while (!existing.empty() && !fs::exists(existing)) {
+        existing = existing.parent_path();
+    }
+    fs::create_directories(dir);
+
+    for (fs::path created = dir; created != existing && !created.empty(); created = created.parent_path()) {
+        syncDirectory(entryDir(created));
+    }
+}
+
+/**
+ * Makes a batch of finished moves durable, then points the catalog at them.
+*/
+static void commitBatch(Database& db, RelocationJournal& journal, const vector<Completion>& batch,
+    RelocationTotals& totals) {
+    std::set<fs::path> dirs;
+    vector<uint64_t> ids;
+    MoveList moves;
+    for (const auto& completion : batch) {
+        dirs.insert(entryDir(completion.from));
+        dirs.insert(entryDir(completion.to));
+        ids.push_back(completion.id);
+        moves.emplace_back(completion.from, completion.to);
+
+        if (completion.first) {
+            totals.relocated++;
+            totals.bytesMoved += completion.result.bytesMoved;
+            totals.bytesCopied += completion.result.bytesCopied;
+        }
+    }
+
+    // One fsync per directory covers every move into or out of it in this batch.
+    for (const auto& dir : dirs) {
+        syncDirectory(dir);
+    }
+    journal.done(ids);
+    db.updateLocations(moves);
+    journal.committed(ids);
+}
+
+/**
+ * @param db catalog to update. Only used from the thread calling run().
+ * @param journalPath where to journal moves while they run.
+ * @param workers number of directories moved into at once.
+ * @param batchSize moves committed to the catalog per transaction.
+*/
+RelocationExecutor::RelocationExecutor(Database& db, const fs::path& journalPath, unsigned int workers,
+    std::size_t batchSize) :
+    m_db(db), m_journalPath(journalPath), m_workers(std::max(workers, 1u)),
+    m_batchSize(std::max<std::size_t>(batchSize, 1)) {}
+
+/**
+ * Runs every task to completion. The journal is removed once every move has been
+ * committed, and kept for recover() if anything throws.
+ *
+ * @param tasks files to move. All of a task's moves go to the same directory.
+ * @return what was moved.
+ * @throws std::runtime_error if the journal, a directory or the catalog can't be updated.
+*/
+RelocationTotals RelocationExecutor::run(const vector<RelocationTask>& tasks) {
+    RelocationTotals totals = {0, 0, 0, 0};
+
+    std::map<fs::path, vector<const RelocationTask*>> byDir;
+    for (const auto& task : tasks) {
+        if (!task.moves.empty()) {
+            byDir[task.moves.front().to.parent_path()].push_back(&task);
+        }
+    }
+    if (byDir.empty()) {
+        return totals;
+    }
+    vector<std::pair<const fs::path, vector<const RelocationTask*>>*> groups;
+    for (auto& group : byDir) {
+        groups.push_back(&group);
+    }
+
+    RelocationJournal journal(this->m_journalPath);
+    BoundedQueue<Completion> completions(this->m_batchSize);
+    std::atomic<std::size_t> nextGroup(0);
+    std::atomic<std::size_t> failed(0);
+    unsigned int threadCount = std::min<std::size_t>(this->m_workers, groups.size());
+    std::atomic<unsigned int> running(threadCount);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto moveGroups = [&]() {
+        for (std::size_t i = nextGroup++; i < groups.size(); i = nextGroup++) {
+            const fs::path& dir = groups[i]->first;
+            const auto& dirTasks = groups[i]->second;
+            try {
+                createDirectory(dir);
+            } catch (const fs::filesystem_error& e) {
+                std::cerr << e.what() << std::endl;
+                failed += dirTasks.size();
+                continue;
+            }
+
+            for (const RelocationTask* task : dirTasks) {
+                for (std::size_t m = 0; m < task->moves.size(); m++) {
+                    const RelocationMove& move = task->moves[m];
+                    std::error_code err;
+                    if (fs::exists(fs::symlink_status(move.to, err))) {
+                        if (fs::equivalent(move.from, move.to, err)) {
+                            continue;   // Already where it belongs
+                        }
+                        std::cerr << "Not relocating " << move.from << ": " << move.to << " already exists" << std::endl;
+                        if (m == 0) failed++;
+                        break;
+                    }
+
+                    uint64_t id = journal.intend(move.from, move.to);
+                    journal.sync(id);
+                    RelocationResult result = Relocator::move(move.from, move.to);
+                    if (!result.success) {
+                        if (m == 0) failed++;
+                        break;
+                    }
+                    if (!completions.push({id, move.from, move.to, m == 0, result})) {
+                        return;     // The committer gave up
+                    }
+                }
+            }
+        }
+    };
+
+    vector<std::thread> workers;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back([&]() {
+            try {
+                moveGroups();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+            if (--running == 0) {
+                completions.close();
+            }
+        });
+    }
+
+    try {
+        vector<Completion> batch;
+        Completion completion;
+        while (completions.pop(completion)) {
+            batch.push_back(std::move(completion));
+            while (batch.size() < this->m_batchSize && completions.tryPop(completion)) {
+                batch.push_back(std::move(completion));
+            }
+            commitBatch(this->m_db, journal, batch, totals);
+            batch.clear();
+        }
+    } catch (...) {
+        completions.close();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    journal.remove();
+    totals.failed = failed;
+    return totals;
+}
+
+/**
+ * Finishes or undoes the moves left in a journal by an interrupted run, then removes it.
+ *
+ * Moves the catalog already follows are left alone. Otherwise the files on disk decide:
+ * a move whose destination exists and whose source is gone finished, as did one marked
+ * done, so the catalog is updated to match. A destination that exists alongside its
+ * source is a partial copy or an unfinished link, and is removed. A move whose
+ * destination doesn't exist never happened.
+ *
+ * @throws std::runtime_error if the catalog can't be updated. The journal is kept.
+*/
+void RelocationExecutor::recover(Database& db, const fs::path& journalPath) {
+    vector<RelocationJournal::Entry> entries = RelocationJournal::read(journalPath);
+
+    MoveList replays;
+    std::set<fs::path> dirs;
+    std::size_t rolledBack = 0;
+    for (const auto& entry : entries) {
+        if (entry.committed) {
+            continue;
+        }
+
+        std::error_code err;
+        bool fromExists = fs::exists(fs::symlink_status(entry.from, err));
+        bool toExists = fs::exists(fs::symlink_status(entry.to, err));
+        if (toExists && (entry.done || !fromExists)) {
+            if (fromExists) {
+                std::cerr << "Relocated " << entry.from << " to " << entry.to << " but left the original behind" << std::endl;
+            }
+            replays.emplace_back(entry.from, entry.to);
+            dirs.insert(entryDir(entry.from));
+            dirs.insert(entryDir(entry.to));
+        } else if (toExists) {
+            if (!fs::remove(entry.to, err)) {
+                std::cerr << "Failed to remove partial relocation " << entry.to << ": " << err.message() << std::endl;
+                continue;
+            }
+            rolledBack++;
+            dirs.insert(entryDir(entry.to));
+        } else if (!fromExists) {
+            std::cerr << "Lost track of " << entry.from << ": neither it nor " << entry.to << " exists" << std::endl;
+        }
+    }
+
+    for (const auto& dir : dirs) {
+        syncDirectory(dir);
+    }
+    if (!replays.empty()) {
+        db.updateLocations(replays);
+    }
+    fs::remove(journalPath);
+
+    std::clog << "Recovered relocation journal: " << replays.size() << " moves replayed, ";
+    std::clog << rolledBack << " rolled back." << std::endl;
+}
@@ -0,0 +1,61 @@
+#ifndef MEMORY_REPLAY_RELOCATION_EXECUTOR_HXX
+#define MEMORY_REPLAY_RELOCATION_EXECUTOR_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "../database/Database.hxx"
+
+namespace fs = std::filesystem;
+using std::vector;
+
+namespace memory_replay {
+    struct RelocationMove {
+        fs::path    from;
+        fs::path    to;
+    };
+
+    /**
+     * Files that move together into one directory, such as a video and its modd. Each
+     * move only runs once the ones before it have succeeded. A file already at its
+     * destination counts as moved.
+    */
+    struct RelocationTask {
+        vector<RelocationMove>  moves;
+    };
+
+    struct RelocationTotals {
+        std::size_t     relocated;      // Tasks whose first move succeeded
+        uint64_t        bytesMoved;     // Of those first moves, bytes moved without copying
+        uint64_t        bytesCopied;    // Of those first moves, bytes copied
+        std::size_t     failed;         // Tasks whose first move failed or was blocked by another file
+    };
+
+    /**
+     * Moves files into the library and points the catalog at their new paths, surviving
+     * a crash at any point.
+     *
+     * Tasks are grouped by destination directory and each group is moved by one of the
+     * worker threads, so directories are created once and workers never contend on the
+     * same one. Every move is journaled before it starts. The calling thread commits
+     * finished moves in batches: it fsyncs every directory the batch touched once, marks
+     * the batch done in the journal, then updates the catalog in one transaction.
+    */
+    class RelocationExecutor {
+    public:
+        RelocationExecutor(Database& db, const fs::path& journalPath, unsigned int workers, std::size_t batchSize);
+
+        RelocationTotals run(const vector<RelocationTask>& tasks);
+
+        static void recover(Database& db, const fs::path& journalPath);
+    private:
+        Database&       m_db;
+        fs::path        m_journalPath;
+        unsigned int    m_workers;
+        std::size_t     m_batchSize;
+    };
+};
+
+#endif // MEMORY_REPLAY_RELOCATION_EXECUTOR_HXX
@@ -0,0 +1,287 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+};
+
+#include "RelocationJournal.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Record types. Each record is a uint32 payload length, a uint32 checksum of the
+ * payload, then the payload: type, uint64 id and, for intents, both paths.
+*/
+enum class RecordType : uint8_t {
+    INTENT = 1,
+    DONE = 2,
+    COMMITTED = 3
+};
+
+static const std::size_t RECORD_HEADER_SIZE = 8;
+
+/**
+ * FNV-1a. Only has to catch records torn by a crash, not deliberate tampering.
+*/
+static uint32_t checksum(const char* data, std::size_t length) {
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+template<typename T>
+static void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void putPath(std::string& out, const fs::path& path) {
+    put<uint32_t>(out, path.native().size());
+    out += path.native();
+}
+
+/**
+ * Frames a payload as a record.
+*/
+static std::string record(const std::string& payload) {
+    std::string out;
+    out.reserve(RECORD_HEADER_SIZE + payload.size());
+    put<uint32_t>(out, payload.size());
+    put<uint32_t>(out, checksum(payload.data(), payload.size()));
+    out += payload;
+    return out;
+}
+
+static std::string idPayload(RecordType type, uint64_t id) {
+    std::string payload;
+    put<uint8_t>(payload, static_cast<uint8_t>(type));
+    put<uint64_t>(payload, id);
+    return payload;
+}
+
+/**
+ * Reads values back out of a payload, failing instead of running past its end.
+*/
+class PayloadReader {
+public:
+    PayloadReader(const char* data, std::size_t length) : m_data(data), m_remaining(length) {};
+
+    template<typename T>
+    bool get(T& value) {
+        if (this->m_remaining < sizeof(T)) return false;
+        std::memcpy(&value, this->m_data, sizeof(T));
+        this->m_data += sizeof(T);
+        this->m_remaining -= sizeof(T);
+        return true;
+    };
+
+    bool getPath(fs::path& path) {
+        uint32_t length;
+        if (!this->get(length) || this->m_remaining < length) return false;
+        path = std::string(this->m_data, length);
+        this->m_data += length;
+        this->m_remaining -= length;
+        return true;
+    };
+private:
+    const char*     m_data;
+    std::size_t     m_remaining;
+};
+
+/**
+ * Starts a new journal.
+ * @throws std::runtime_error if it can't be created, or a journal that still needs
+ *      recovering is in the way.
+*/
+RelocationJournal::RelocationJournal(const fs::path& path) :
+    m_path(path), m_nextId(1), m_appendedId(0), m_syncedId(0), m_syncing(false) {
+    std::error_code err;
+    if (fs::file_size(path, err) > 0 && !err) {
+        throw std::runtime_error("Relocation journal " + path.string() + " has not been recovered");
+    }
+
+    this->m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (this->m_fd < 0) {
+        throw std::runtime_error("Failed to create relocation journal " + path.string() + ": " + std::strerror(errno));
+    }
+
+    // The journal's own directory entry has to survive a crash too.
+    fs::path dir = fs::absolute(path).parent_path();
+    int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+RelocationJournal::~RelocationJournal() {
+    if (this->m_fd >= 0) {
+        close(this->m_fd);
+    }
+}
+
+/**
+ * Records that a file is about to move. The move must not start until sync(id) returns.
+ * @return id of the move.
+*/
+uint64_t RelocationJournal::intend(const fs::path& from, const fs::path& to) {
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    uint64_t id = this->m_nextId++;
+
+    std::string payload;
+    put<uint8_t>(payload, static_cast<uint8_t>(RecordType::INTENT));
+    put<uint64_t>(payload, id);
+    putPath(payload, from);
+    putPath(payload, to);
+    this->append(record(payload));
+
+    this->m_appendedId = id;
+    return id;
+}
+
+/**
+ * Records that these moves have finished and their files and directories are on disk.
+ * Synced before returning, so the catalog can then be pointed at the new paths: recovery
+ * must never undo a move the catalog already follows.
+*/
+void RelocationJournal::done(const std::vector<uint64_t>& ids) {
+    std::string records;
+    for (uint64_t id : ids) {
+        records += record(idPayload(RecordType::DONE, id));
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->append(records);
+    }
+    if (fdatasync(this->m_fd) != 0) {
+        throw std::runtime_error(std::string("Failed to sync relocation journal: ") + std::strerror(errno));
+    }
+}
+
+/**
+ * Records that the catalog has been updated for these moves.
+*/
+void RelocationJournal::committed(const std::vector<uint64_t>& ids) {
+    std::string records;
+    for (uint64_t id : ids) {
+        records += record(idPayload(RecordType::COMMITTED, id));
+    }
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    this->append(records);
+}
+
+/**
+ * Waits until the intent with this id is on disk, syncing it along with every other
+ * record appended so far unless another thread's sync already covers it.
+*/
+void RelocationJournal::sync(uint64_t id) {
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    while (this->m_syncedId < id) {
+        if (this->m_syncing) {
+            this->m_synced.wait(lock);
+            continue;
+        }
+
+        this->m_syncing = true;
+        uint64_t target = this->m_appendedId;
+        lock.unlock();
+        int result = fdatasync(this->m_fd);
+        int err = errno;
+        lock.lock();
+        this->m_syncing = false;
+        if (result == 0) {
+            this->m_syncedId = target;
+        }
+        this->m_synced.notify_all();
+        if (result != 0) {
+            throw std::runtime_error(std::string("Failed to sync relocation journal: ") + std::strerror(err));
+        }
+    }
+}
+
+/**
+ * Deletes the journal once every move in it has been committed.
+*/
+void RelocationJournal::remove() {
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    close(this->m_fd);
+    this->m_fd = -1;
+    fs::remove(this->m_path);
+}
+
+/**
+ * Must be called with m_mutex held. O_APPEND keeps each record contiguous.
+*/
+void RelocationJournal::append(const std::string& records) {
+    const char* data = records.data();
+    std::size_t remaining = records.size();
+    while (remaining > 0) {
+        ssize_t count = write(this->m_fd, data, remaining);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            throw std::runtime_error(std::string("Failed to write relocation journal: ") + std::strerror(errno));
+        }
+        data += count;
+        remaining -= count;
+    }
+}
+
+/**
+ * Reads every move recorded in a journal, in the order they were intended.
+ * Anything after a torn or corrupt record is ignored.
+*/
+std::vector<RelocationJournal::Entry> RelocationJournal::read(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t, std::size_t> byId;
+    std::size_t offset = 0;
+    while (data.size() - offset >= RECORD_HEADER_SIZE) {
+        uint32_t length;
+        uint32_t sum;
+        std::memcpy(&length, data.data() + offset, sizeof(length));
+        std::memcpy(&sum, data.data() + offset + sizeof(length), sizeof(sum));
+        offset += RECORD_HEADER_SIZE;
+        if (data.size() - offset < length || checksum(data.data() + offset, length) != sum) {
+            break;
+        }
+
+        PayloadReader payload(data.data() + offset, length);
+        offset += length;
+        uint8_t type;
+        uint64_t id;
+        if (!payload.get(type) || !payload.get(id)) {
+            break;
+        }
+
+        if (type == static_cast<uint8_t>(RecordType::INTENT)) {
+            Entry entry = {id, fs::path(), fs::path(), false, false};
+            if (!payload.getPath(entry.from) || !payload.getPath(entry.to)) {
+                break;
+            }
+            byId[id] = entries.size();
+            entries.push_back(std::move(entry));
+            continue;
+        }
+
+        auto found = byId.find(id);
+        if (found == byId.end()) {
+            continue;
+        }
+        if (type == static_cast<uint8_t>(RecordType::DONE)) {
+            entries[found->second].done = true;
+        } else if (type == static_cast<uint8_t>(RecordType::COMMITTED)) {
+            entries[found->second].committed = true;
+        }
+    }
+
+    return entries;
+}
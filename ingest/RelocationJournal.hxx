@@ -0,0 +1,69 @@
+#ifndef MEMORY_REPLAY_RELOCATION_JOURNAL_HXX
+#define MEMORY_REPLAY_RELOCATION_JOURNAL_HXX
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const char RELOCATION_JOURNAL[] = "library.relocations";
+
+    /**
+     * Append-only record of file moves, so a relocation interrupted by a crash can be
+     * finished or undone on the next start.
+     *
+     * Every move is recorded as an intent before it starts, then marked done once the
+     * file and both directories are on disk, then committed once the catalog points at
+     * the new path. Records carry a checksum; reading stops at the first torn one.
+     *
+     * Only intents have to be durable before their move starts. sync() group-commits:
+     * whichever thread gets there first fsyncs everything appended so far, and every
+     * thread waiting on a record it covered returns together.
+    */
+    class RelocationJournal {
+    public:
+        /**
+         * A move read back from a journal.
+        */
+        struct Entry {
+            uint64_t    id;
+            fs::path    from;
+            fs::path    to;
+            bool        done;
+            bool        committed;
+        };
+
+        explicit RelocationJournal(const fs::path& path);
+        ~RelocationJournal();
+
+        RelocationJournal(const RelocationJournal&) = delete;
+        RelocationJournal& operator=(const RelocationJournal&) = delete;
+
+        uint64_t intend(const fs::path& from, const fs::path& to);
+        void done(const std::vector<uint64_t>& ids);
+        void committed(const std::vector<uint64_t>& ids);
+        void sync(uint64_t id);
+
+        void remove();
+
+        static std::vector<Entry> read(const fs::path& path);
+    private:
+        fs::path                    m_path;
+        int                         m_fd;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_synced;
+        uint64_t                    m_nextId;
+        uint64_t                    m_appendedId;   // Highest intent appended
+        uint64_t                    m_syncedId;     // Highest intent known to be on disk
+        bool                        m_syncing;
+
+        void append(const std::string& record);
+    };
+};
+
+#endif // MEMORY_REPLAY_RELOCATION_JOURNAL_HXX
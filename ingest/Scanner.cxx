@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+};
+
+#include "../metadata/Video.hxx"
+#include "Scanner.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Layout of the records getdents64(2) fills its buffer with. glibc only exposes the
+ * call itself, not the struct.
+*/
+struct LinuxDirent64 {
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+/**
+ * A directory waiting to be read. fd is already open on it, or -1 to open it by path.
+*/
+struct PendingDir {
+    string  path;
+    int     fd;
+};
+
+/**
+ * Shared between the threads of one scan.
+*/
+struct CrawlState {
+    const Scanner::Visitor&     visit;
+    std::mutex                  mutex;
+    std::condition_variable     ready;
+    std::deque<PendingDir>      pending;
+    std::size_t                 queuedFds;      // fds held open by pending
+    unsigned int                busy;           // Threads reading a directory
+    bool                        stopped;        // A visit returned false or threw
+    std::exception_ptr          error;
+    std::mutex                  visitMutex;     // Visitors are called one at a time
+};
+
+/**
+ * The .modd files and best-ranked videos of one directory, and its subdirectories.
+ * Reused from one directory to the next by each thread.
+*/
+struct DirListing {
+    std::vector<string>                                 modds;
+    std::unordered_map<string, std::pair<int, string>>  videos;     // Stem to (rank, name)
+    std::vector<string>                                 subdirs;
+    std::vector<char>                                   buffer;
+};
+
+/**
+ * Joins a directory path and the name of an entry in it.
+*/
+static string joinPath(const string& dir, const string& name) {
+    return dir.back() == '/' ? dir + name : dir + '/' + name;
+}
+
+/**
+ * Works out whether an entry is a directory to descend into or a regular file to report.
+ * d_type answers without a stat on almost every filesystem; the rest report DT_UNKNOWN.
+ * Like directory_entry::is_regular_file, symlinks to regular files count as files, while
+ * symlinks to directories aren't followed.
+*/
+static unsigned char entryType(int dirFd, const LinuxDirent64* entry) {
+    unsigned char type = entry->d_type;
+    if (type != DT_UNKNOWN && type != DT_LNK) {
+        return type;
+    }
+
+    struct stat entryStat;
+    int flags = type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW;
+    if (fstatat(dirFd, entry->d_name, &entryStat, flags) != 0) {
+        return DT_UNKNOWN;
+    }
+    if (S_ISREG(entryStat.st_mode)) return DT_REG;
+    if (S_ISDIR(entryStat.st_mode) && type != DT_LNK) return DT_DIR;
+    return DT_UNKNOWN;
+}
+
+/**
+ * Reads every entry of a directory into listing.
+ * @return false if the directory couldn't be read.
+*/
+static bool listDirectory(int dirFd, DirListing& listing) {
+    listing.modds.clear();
+    listing.videos.clear();
+    listing.subdirs.clear();
+
+    while (true) {
+        long count = syscall(SYS_getdents64, dirFd, listing.buffer.data(), listing.buffer.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        if (count == 0) return true;
+
+        for (long offset = 0; offset < count; ) {
+            const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(listing.buffer.data() + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = entryType(dirFd, entry);
+            if (type == DT_DIR) {
+                listing.subdirs.emplace_back(name);
+                continue;
+            }
+            if (type != DT_REG) {
+                continue;
+            }
+            Stats::global().add(Counter::FILES_SCANNED);
+
+            // Same split as fs::path: a leading dot starts the stem, not an extension.
+            const char* dot = std::strrchr(name, '.');
+            if (dot == nullptr || dot == name) {
+                continue;
+            }
+            std::size_t nameLength = std::strlen(name);
+            bool lowerCase;
+            int extIndex = MEDIA_EXTS.find(dot, name + nameLength - dot, lowerCase);
+            if (extIndex < 0) {
+                continue;
+            }
+
+            if (extIndex == MODD_EXT_INDEX) {
+                if (lowerCase) {
+                    listing.modds.emplace_back(name, nameLength);
+                }
+                continue;
+            }
+
+            int rank = 2 * extIndex + (lowerCase ? 0 : 1);
+            auto& best = listing.videos[string(name, dot - name)];
+            if (best.second.empty() || rank < best.first) {
+                best = std::make_pair(rank, string(name, nameLength));
+            }
+        }
+    }
+}
+
+/**
+ * Reads one directory, queues its subdirectories and reports its clips.
+ * @return false if a visitor asked to stop.
+*/
+static bool crawlDirectory(CrawlState& state, PendingDir& dir, DirListing& listing) {
+    {
+        ScopedTimer timer(Stage::SCAN);
+        Stats::global().addItems(Stage::SCAN);
+
+        int dirFd = dir.fd >= 0 ? dir.fd : open(dir.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) {
+            Stats::global().addError(Stage::SCAN);
+            std::cerr << "Failed to open directory " << dir.path << ": " << std::strerror(errno) << std::endl;
+            return true;
+        }
+        if (!listDirectory(dirFd, listing)) {
+            Stats::global().addError(Stage::SCAN);
+            std::cerr << "Failed to read directory " << dir.path << ": " << std::strerror(errno) << std::endl;
+        }
+
+        // Open subdirectories while their parent is, so they're found without another path walk.
+        std::size_t fdBudget;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            fdBudget = std::min(listing.subdirs.size(), MAX_QUEUED_DIR_FDS - state.queuedFds);
+            state.queuedFds += fdBudget;
+        }
+        std::vector<PendingDir> children;
+        std::size_t opened = 0;
+        for (std::size_t i = 0; i < listing.subdirs.size(); i++) {
+            const string& subdir = listing.subdirs[i];
+            PendingDir child = {joinPath(dir.path, subdir), -1};
+            if (i < fdBudget) {
+                child.fd = openat(dirFd, subdir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+                if (child.fd >= 0) opened++;
+            }
+            children.push_back(std::move(child));
+        }
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.queuedFds -= fdBudget - opened;
+            for (auto& child : children) {
+                state.pending.push_back(std::move(child));
+            }
+        }
+        state.ready.notify_all();
+        close(dirFd);
+    }
+
+    std::lock_guard<std::mutex> visitLock(state.visitMutex);
+    for (const auto& modd : listing.modds) {
+        ScanItem item;
+        item.modd = joinPath(dir.path, modd);
+        auto video = listing.videos.find(item.modd.stem().native());
+        if (video != listing.videos.end()) {
+            item.video = joinPath(dir.path, video->second.second);
+        }
+
+        if (!state.visit(std::move(item))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Scan thread. Takes directories from the shared queue until none are left and no
+ * other thread can add more.
+*/
+static void crawl(CrawlState& state) {
+    DirListing listing;
+    listing.buffer.resize(DIRENT_BUFFER_SIZE);
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (true) {
+        state.ready.wait(lock, [&state] { return state.stopped || !state.pending.empty() || state.busy == 0; });
+        if (state.stopped || state.pending.empty()) break;
+
+        PendingDir dir = std::move(state.pending.front());
+        state.pending.pop_front();
+        if (dir.fd >= 0) state.queuedFds--;
+        state.busy++;
+        lock.unlock();
+
+        bool keepGoing = false;
+        try {
+            keepGoing = crawlDirectory(state, dir, listing);
+        } catch (...) {
+            lock.lock();
+            if (!state.error) state.error = std::current_exception();
+            lock.unlock();
+        }
+
+        lock.lock();
+        state.busy--;
+        if (!keepGoing) state.stopped = true;
+        // Wakes idle threads to new work, or to finish if this was the last busy one.
+        state.ready.notify_all();
+    }
+}
+
+/**
+ * Scans every directory below root, reading up to threads directories at once.
+ * Directories are read with getdents64(2) and classified by d_type, so files are only
+ * stat'ed where the filesystem doesn't report their type.
+ *
+ * @param root directory to start from.
+ * @param visit called for every .modd file found, along with its matched video. Calls
+ *      never overlap, but may come from any scan thread, in no particular order.
+ * @param threads number of scan threads. With 1, the scan runs on the calling thread.
+*/
+void Scanner::scan(const fs::path& root, const Visitor& visit, unsigned int threads) {
+    CrawlState state = {visit};
+    state.queuedFds = 0;
+    state.busy = 0;
+    state.stopped = false;
+    state.pending.push_back({root.native(), -1});
+
+    // Paths below are joined onto the root, so drop any trailing slashes it came with.
+    string& rootPath = state.pending.front().path;
+    while (rootPath.size() > 1 && rootPath.back() == '/') {
+        rootPath.pop_back();
+    }
+
+    if (threads <= 1) {
+        crawl(state);
+    } else {
+        std::vector<std::thread> crawlers;
+        for (unsigned int i = 0; i < threads; i++) {
+            crawlers.emplace_back([&state] { crawl(state); });
+        }
+        for (auto& crawler : crawlers) {
+            crawler.join();
+        }
+    }
+
+    // Directories left behind by a stopped scan.
+    for (const auto& dir : state.pending) {
+        if (dir.fd >= 0) close(dir.fd);
+    }
+
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+}
+
+/**
+ * Ranks a video file extension by preference when several videos share a stem.
+ * Follows the order of VIDEO_EXTS, preferring lower case over any other casing.
+ *
+ * @param ext file extension including the leading dot.
+ * @return rank, lowest first, or -1 if ext isn't a video extension.
+*/
+int Scanner::videoExtRank(const fs::path& ext) {
+    bool lowerCase;
+    int extIndex = MEDIA_EXTS.find(ext.native(), lowerCase);
+    if (extIndex < 0 || extIndex == MODD_EXT_INDEX) {
+        return -1;
+    }
+    return 2 * extIndex + (lowerCase ? 0 : 1);
+}
@@ -0,0 +1,45 @@
+#ifndef MEMORY_REPLAY_SCANNER_HXX
+#define MEMORY_REPLAY_SCANNER_HXX
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const std::size_t DIRENT_BUFFER_SIZE = 65536;   // Bytes of entries per getdents64 call
+    static const std::size_t MAX_QUEUED_DIR_FDS = 256;     // Directories queued already open
+
+    /**
+     * A .modd file and the video next to it. video is empty if no video was found.
+    */
+    struct ScanItem {
+        fs::path    modd;
+        fs::path    video;
+    };
+
+    /**
+     * Walks a directory tree one directory at a time. Every entry of a directory is read
+     * before any of its .modd files are reported, so each one can be matched against an
+     * index of the directory's videos instead of probing the filesystem for candidates.
+     *
+     * Several threads can read directories at once, each taking the next queued one.
+     * A directory's subdirectories are opened with openat(2) while it is still open,
+     * up to MAX_QUEUED_DIR_FDS at a time, so most are reached without a path lookup.
+     * Extensions are matched through MEDIA_EXTS without building any strings.
+    */
+    class Scanner {
+    public:
+        /**
+         * Receives each item found. Returning false stops the scan.
+        */
+        typedef std::function<bool(ScanItem&&)> Visitor;
+
+        static void scan(const fs::path& root, const Visitor& visit, unsigned int threads = 1);
+
+        static int videoExtRank(const fs::path& ext);
+    };
+};
+
+#endif // MEMORY_REPLAY_SCANNER_HXX
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+extern "C" {
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+};
+
+#include "Watcher.hxx"
+#include "../metadata/Video.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+static const uint32_t DIR_EVENTS = IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE | IN_MODIFY | IN_ONLYDIR;
+
+/**
+ * Creates the inotify instance and a signalfd for SIGINT and SIGTERM, which stop
+ * watch() cleanly. Both signals stay blocked for the calling thread.
+ *
+ * @param root directory tree to watch.
+ * @param debounce how long a clip must go untouched before it's reported.
+*/
+Watcher::Watcher(const fs::path& root, std::chrono::milliseconds debounce) : m_root(root), m_debounce(debounce) {
+    this->m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->m_inotifyFd < 0) {
+        throw std::runtime_error(string("inotify_init1 failed: ") + std::strerror(errno));
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    this->m_signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (this->m_signalFd < 0) {
+        close(this->m_inotifyFd);
+        throw std::runtime_error(string("signalfd failed: ") + std::strerror(errno));
+    }
+}
+
+Watcher::~Watcher() {
+    close(this->m_signalFd);
+    close(this->m_inotifyFd);
+}
+
+/**
+ * Watches until SIGINT or SIGTERM arrives, handing settled clips to onReady.
+ * Clips still pending when the signal arrives are reported before returning.
+*/
+void Watcher::watch(const Handler& onReady) {
+    this->addWatches(this->m_root, false);
+    std::clog << "Watching " << this->m_dirs.size() << " directories under " << this->m_root << std::endl;
+
+    struct pollfd fds[2] = {
+        {this->m_inotifyFd, POLLIN, 0},
+        {this->m_signalFd, POLLIN, 0}
+    };
+
+    while (true) {
+        // Sleep until there's an event or the oldest pending clip settles.
+        int timeout = -1;
+        if (!this->m_pending.empty()) {
+            auto oldest = std::min_element(this->m_pending.begin(), this->m_pending.end(),
+                [](const auto& a, const auto& b) { return a.second < b.second; })->second;
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(oldest + this->m_debounce - Clock::now());
+            timeout = std::max<long>(wait.count(), 0);
+        }
+
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+            throw std::runtime_error(string("poll failed: ") + std::strerror(errno));
+        }
+
+        if (fds[1].revents & POLLIN) {
+            std::vector<ScanItem> remaining = this->takeReady(Clock::time_point::max());
+            if (!remaining.empty()) {
+                onReady(std::move(remaining));
+            }
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            this->readEvents();
+        }
+
+        std::vector<ScanItem> ready = this->takeReady(Clock::now());
+        if (!ready.empty()) {
+            onReady(std::move(ready));
+        }
+    }
+}
+
+/**
+ * Adds a watch to dir and every directory below it.
+ * @param markExisting also mark the clips already inside as pending. Used for directories
+ *        created while watching, whose files may have been written before the watch existed.
+*/
+void Watcher::addWatches(const fs::path& dir, bool markExisting) {
+    std::vector<fs::path> pending = {dir};
+    while (!pending.empty()) {
+        fs::path current = std::move(pending.back());
+        pending.pop_back();
+
+        int wd = inotify_add_watch(this->m_inotifyFd, current.c_str(), DIR_EVENTS);
+        if (wd < 0) {
+            Stats::global().addError(Stage::SCAN);
+            std::cerr << "Failed to watch " << current << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        this->m_dirs[wd] = current;
+
+        std::error_code error;
+        for (const auto& entry : fs::directory_iterator(current, error)) {
+            if (entry.is_directory() && !entry.is_symlink()) {
+                pending.push_back(entry.path());
+            } else if (markExisting && entry.is_regular_file()) {
+                this->markPending(entry.path());
+            }
+        }
+    }
+}
+
+/**
+ * Drains every queued inotify event.
+*/
+void Watcher::readEvents() {
+    alignas(struct inotify_event) char buffer[65536];
+    while (true) {
+        ssize_t length = read(this->m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ) {
+            auto event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, so anything under the root may have changed.
+                std::cerr << "inotify queue overflowed, rescanning " << this->m_root << std::endl;
+                Scanner::scan(this->m_root, [this](ScanItem&& item) {
+                    this->markPending(item.modd);
+                    return true;
+                });
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                this->m_dirs.erase(event->wd);
+                continue;
+            }
+
+            auto dir = this->m_dirs.find(event->wd);
+            if (dir == this->m_dirs.end() || event->len == 0) {
+                continue;
+            }
+            fs::path path = dir->second / event->name;
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    this->addWatches(path, true);
+                }
+            } else {
+                this->markPending(path);
+            }
+        }
+    }
+}
+
+/**
+ * Restarts the debounce timer of the clip a .modd or video file belongs to.
+*/
+void Watcher::markPending(const fs::path& path) {
+    fs::path ext = path.extension();
+    if (ext != ".modd" && Scanner::videoExtRank(ext) < 0) {
+        return;
+    }
+
+    fs::path clip = path;
+    clip.replace_extension();
+    this->m_pending[clip.native()] = Clock::now();
+}
+
+/**
+ * Removes every clip that has been quiet since before now minus the debounce interval.
+ * @return the clips that still have a .modd file.
+*/
+std::vector<ScanItem> Watcher::takeReady(Clock::time_point now) {
+    std::vector<ScanItem> ready;
+    for (auto it = this->m_pending.begin(); it != this->m_pending.end(); ) {
+        if (now != Clock::time_point::max() && it->second + this->m_debounce > now) {
+            ++it;
+            continue;
+        }
+
+        ScanItem item;
+        if (resolve(it->first, item)) {
+            ready.push_back(std::move(item));
+        }
+        it = this->m_pending.erase(it);
+    }
+    return ready;
+}
+
+/**
+ * Finds the files of a clip. Its directory is listed so video extensions match in any
+ * casing, and the best is picked by the Scanner's ranking.
+ * @param clip the clip's path without an extension.
+ * @param item receives the .modd and video paths.
+ * @return false if the clip has no .modd file.
+*/
+bool Watcher::resolve(const fs::path& clip, ScanItem& item) {
+    item.modd = clip;
+    item.modd += ".modd";
+    if (!fs::is_regular_file(item.modd)) {
+        return false;
+    }
+
+    item.video.clear();
+    int bestRank = -1;
+    std::error_code err;
+    for (const auto& entry : fs::directory_iterator(clip.parent_path(), err)) {
+        const fs::path& path = entry.path();
+        if (path.stem() != clip.filename()) {
+            continue;
+        }
+        int rank = Scanner::videoExtRank(path.extension());
+        if (rank >= 0 && (bestRank < 0 || rank < bestRank) && entry.is_regular_file(err)) {
+            bestRank = rank;
+            item.video = path;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef MEMORY_REPLAY_WATCHER_HXX
+#define MEMORY_REPLAY_WATCHER_HXX
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Scanner.hxx"
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const std::chrono::milliseconds DEFAULT_DEBOUNCE(2000);     // Quiet time before a changed clip is ingested
+
+    /**
+     * Watches a directory tree with inotify and reports clips as they finish changing.
+     *
+     * Every directory under the root gets a watch, including ones created later. A write
+     * to a .modd or video file marks its clip (directory plus stem) as pending. The clip
+     * is reported once neither of its files has been touched for the debounce interval,
+     * so a camera dump still being copied isn't picked up half written.
+     *
+     * fanotify isn't used: it needs CAP_SYS_ADMIN, and inotify covers a library tree.
+    */
+    class Watcher {
+    public:
+        /**
+         * Receives each group of clips that have settled.
+        */
+        typedef std::function<void(std::vector<ScanItem>&& items)> Handler;
+
+        Watcher(const fs::path& root, std::chrono::milliseconds debounce = DEFAULT_DEBOUNCE);
+        ~Watcher();
+
+        void watch(const Handler& onReady);
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        fs::path                    m_root;
+        std::chrono::milliseconds   m_debounce;
+        int                         m_inotifyFd;
+        int                         m_signalFd;
+
+        std::unordered_map<int, fs::path>                   m_dirs;     // Watch descriptor to directory
+        std::unordered_map<std::string, Clock::time_point>  m_pending;  // Clip (directory/stem) to its last change
+
+        void addWatches(const fs::path& dir, bool markExisting);
+        void readEvents();
+        void markPending(const fs::path& path);
+        std::vector<ScanItem> takeReady(Clock::time_point now);
+
+        static bool resolve(const fs::path& clip, ScanItem& item);
+    };
+};
+
+#endif // MEMORY_REPLAY_WATCHER_HXX
@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <filesystem>
+#include <iterator>
 #include <string>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 extern "C" {
 #include <unistd.h>
@@ -10,6 +14,14 @@ extern "C" {
 #include "metadata/Modd.hxx"
 #include "metadata/Video.hxx"
 #include "database/Database.hxx"
+#include "ingest/Pipeline.hxx"
+#include "ingest/RelocationExecutor.hxx"
+#include "ingest/RelocationJournal.hxx"
+#include "ingest/Watcher.hxx"
+#include "report/DuplicateFinder.hxx"
+#include "report/TranscodeQueue.hxx"
+#include "report/SnapshotWriter.hxx"
+#include "stats/Stats.hxx"
 
 using namespace memory_replay;
 namespace fs = std::filesystem;
@@ -22,15 +34,59 @@ int main(int argc, char** argv) {
 
     map<const Option, bool> enabledOpts = {
         {Option::Update, false},
-        {Option::Relocate, false}
+        {Option::Relocate, false},
+        {Option::Incremental, false},
+        {Option::Stream, false},
+        {Option::Dupes, false},
+        {Option::Queue, false},
+        {Option::Watch, false},
+        {Option::Export, false},
+        {Option::Stats, false}
     };
 
     fs::path searchDir("./");
     fs::path outDir("./");
+    fs::path dupesDir("./");
+    fs::path queuePrefix("queue");
+    fs::path watchDir("./");
+    fs::path snapshotPath("library.snap");
+
+    QueueOptions queueOpts;
+    queueOpts.shards = 1;
+    queueOpts.outputDir = fs::path("./");
+    queueOpts.encoder = DEFAULT_ENCODER;
+    queueOpts.quality = DEFAULT_QUALITY;
+
+    PipelineOptions pipelineOpts;
+    pipelineOpts.workers = std::thread::hardware_concurrency();
+    pipelineOpts.queueDepth = DEFAULT_QUEUE_DEPTH;
+    pipelineOpts.batchSize = DEFAULT_BATCH_SIZE;
+    pipelineOpts.incremental = false;
+    pipelineOpts.keepUnchanged = false;
+    pipelineOpts.hashStrategy = HashStrategy::HEAD;
+    pipelineOpts.ioEngine = IoEngine::URING;
+    pipelineOpts.ioThreads = DEFAULT_IO_THREADS;
+    pipelineOpts.ioDepth = DEFAULT_IO_DEPTH;
+    pipelineOpts.ioBuffers = DEFAULT_IO_BUFFERS;
+
+    DatabaseProfile dbProfile = FAST_PROFILE;
+    unsigned int statsInterval = 0;
 
     int opt;
-    while ((opt = getopt(argc, argv, OPTS_STR)) != -1) {
-        // 'u' updates the DB. 'r' relocates files to the specified location
+    while ((opt = getopt_long(argc, argv, OPTS_STR, LONG_OPTS, nullptr)) != -1) {
+        // 'u' updates the DB. 'r' relocates files to the specified location. 'j' sets the worker count.
+        // 'i' skips files that haven't changed since the last update.
+        // 'f' picks the video fingerprint strategy: head, sampled or full.
+        // 'd' reports duplicate videos under a directory.
+        // 'q' writes HandBrake queues for every MPEG-2 video to <prefix>-<n>.json, balanced
+        // across '--shards N' files, encoding into '--encode-dir DIR'.
+        // 'w' keeps running, ingesting clips under a directory as they are written.
+        // 'e' exports the catalog as a memory-mappable snapshot for read-only tools.
+        // 's' relocates and frees each batch as soon as it is committed. 'b' sets the batch size.
+        // '--db-profile' picks the SQLite settings: fast (WAL) or safe.
+        // '--io-engine' picks how videos are read for hashing: uring, threads or inline.
+        // '--io-threads', '--io-depth' and '--io-buffers' size the hashing threads and their engines.
+        // '--stats[=N]' dumps counters as JSON at exit, and every N seconds if given.
         switch (opt) {
             case 'u':
                 searchDir = fs::path(optarg);
@@ -40,6 +96,73 @@ int main(int argc, char** argv) {
                 outDir = fs::path(optarg);
                 enabledOpts[Option::Relocate] = true;
                 break;
+            case 'j':
+                pipelineOpts.workers = std::stoul(optarg);
+                break;
+            case 'i':
+                enabledOpts[Option::Incremental] = true;
+                break;
+            case 'f':
+                if (!Fingerprint::parseStrategy(optarg, pipelineOpts.hashStrategy)) {
+                    std::cerr << "unknown fingerprint strategy: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case 'd':
+                dupesDir = fs::path(optarg);
+                enabledOpts[Option::Dupes] = true;
+                break;
+            case 'w':
+                watchDir = fs::path(optarg);
+                enabledOpts[Option::Watch] = true;
+                break;
+            case 'e':
+                snapshotPath = fs::path(optarg);
+                enabledOpts[Option::Export] = true;
+                break;
+            case 'q':
+                queuePrefix = fs::path(optarg);
+                enabledOpts[Option::Queue] = true;
+                break;
+            case SHARDS_OPT:
+                queueOpts.shards = std::max<unsigned long>(std::stoul(optarg), 1);
+                break;
+            case ENCODE_DIR_OPT:
+                queueOpts.outputDir = fs::path(optarg);
+                break;
+            case 's':
+                enabledOpts[Option::Stream] = true;
+                break;
+            case 'b':
+                pipelineOpts.batchSize = std::max<std::size_t>(std::stoul(optarg), 1);
+                break;
+            case DB_PROFILE_OPT:
+                if (!DatabaseProfile::parse(optarg, dbProfile)) {
+                    std::cerr << "unknown database profile: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case IO_ENGINE_OPT:
+                if (!ReadEngine::parseEngine(optarg, pipelineOpts.ioEngine)) {
+                    std::cerr << "unknown io engine: " << optarg << std::endl;
+                    return 1;
+                }
+                break;
+            case IO_THREADS_OPT:
+                pipelineOpts.ioThreads = std::max<unsigned long>(std::stoul(optarg), 1);
+                break;
+            case IO_DEPTH_OPT:
+                pipelineOpts.ioDepth = std::max<unsigned long>(std::stoul(optarg), 1);
+                break;
+            case IO_BUFFERS_OPT:
+                pipelineOpts.ioBuffers = std::max<unsigned long>(std::stoul(optarg), 1);
+                break;
+            case STATS_OPT:
+                enabledOpts[Option::Stats] = true;
+                if (optarg != nullptr) {
+                    statsInterval = std::stoul(optarg);
+                }
+                break;
             case ':':
                 std::cerr << "option needs a value" << std::endl;
                 break;
@@ -49,57 +172,124 @@ int main(int argc, char** argv) {
         }
     }
 
-    std::vector<Modd*> moddList;
-    std::vector<Video*> videoList;
+    // Touching the stats here starts their elapsed-time clock.
+    Stats::global();
+    std::unique_ptr<StatsReporter> statsReporter;
+    if (statsInterval > 0) {
+        statsReporter.reset(new StatsReporter(std::cerr, statsInterval));
+    }
 
-    if (enabledOpts[Option::Update]) {
-        std::cout << "Searching for modd files..." << std::endl;
-        for (auto& p : fs::recursive_directory_iterator(searchDir)) {
-            if (p.is_regular_file()) {
-                auto filePath = p.path();
-                if (filePath.extension()  == ".modd") {
-                    moddList.push_back(new Modd(filePath));
-                }
+    // Finish or undo whatever an interrupted relocation left behind before touching the library.
+    if (fs::exists(RELOCATION_JOURNAL)) {
+        Database db(fs::path("library.db"), dbProfile);
+        RelocationExecutor::recover(db, RELOCATION_JOURNAL);
+    }
+
+    std::size_t relocated = 0;
+    uint64_t bytesMoved = 0;
+    uint64_t bytesCopied = 0;
+    std::size_t relocationsFailed = 0;
+    auto relocate = [&](Database& db, std::vector<Clip>& clips) {
+        std::vector<RelocationTask> tasks;
+        for (auto& clip : clips) {
+            if (!clip.video) {
+                continue;
             }
+            // The modd only follows once its video has actually moved.
+            fs::path dir = clip.video->relocationDir(outDir);
+            RelocationTask task;
+            task.moves.push_back({clip.video->getLocation().path(), fs::path(dir).concat(clip.video->getName())});
+            task.moves.push_back({clip.modd->getPath().path(), fs::path(dir).concat(clip.modd->getName())});
+            tasks.push_back(std::move(task));
         }
 
-        Database db(fs::path("library.db"));
+        RelocationExecutor executor(db, RELOCATION_JOURNAL, pipelineOpts.workers, pipelineOpts.batchSize);
+        RelocationTotals totals = executor.run(tasks);
+        relocated += totals.relocated;
+        bytesMoved += totals.bytesMoved;
+        bytesCopied += totals.bytesCopied;
+        relocationsFailed += totals.failed;
+    };
 
-        // Add modds to db
-        std::cout << "Updating modd files in database..." << std::endl;
-        db.addEntries(moddList);
+    // Clips kept for relocation after the update. Stays empty in streaming mode.
+    std::vector<Clip> clipList;
 
-        std::cout << "Searching for video files..." << std::endl;
-        
-        for (auto& modd : moddList) {
-            videoList.push_back(new Video(*modd));
-        }
+    // Clips already stored still need relocating, even when they're skipped as unchanged.
+    pipelineOpts.keepUnchanged = enabledOpts[Option::Relocate];
+
+    if (enabledOpts[Option::Update]) {
+        Database db(fs::path("library.db"), dbProfile);
 
-        // Add videos to db
-        std::cout << "Updating video files in database..." << std::endl;
-        db.updateEntries(videoList);
+        // Scan, parse, hash and store everything in one pass.
+        std::cout << "Updating modd and video files in database..." << std::endl;
+        pipelineOpts.incremental = enabledOpts[Option::Incremental];
+        Pipeline pipeline(db, pipelineOpts);
+        pipeline.run(searchDir, [&](std::vector<Clip>& batch) {
+            if (enabledOpts[Option::Stream]) {
+                // Each batch is relocated here on the writer thread and freed once this returns.
+                if (enabledOpts[Option::Relocate]) {
+                    relocate(db, batch);
+                }
+            } else if (enabledOpts[Option::Relocate]) {
+                std::move(batch.begin(), batch.end(), std::back_inserter(clipList));
+            }
+        });
+    }
+
+    if (enabledOpts[Option::Watch]) {
+        Database db(fs::path("library.db"), dbProfile);
+
+        // Clips are relocated as soon as they're stored, as in streaming mode.
+        // Created only now, so interrupts still stop the update above. The pipeline's threads
+        // start later and inherit the signals it blocks.
+        Watcher watcher(watchDir);
+        std::cout << "Watching for new clips. Interrupt to stop." << std::endl;
+        pipelineOpts.incremental = true;
+        Pipeline pipeline(db, pipelineOpts);
+        watcher.watch([&](std::vector<ScanItem>&& items) {
+            std::clog << items.size() << " changed clips." << std::endl;
+            pipeline.run(items, [&](std::vector<Clip>& batch) {
+                if (enabledOpts[Option::Relocate]) {
+                    relocate(db, batch);
+                }
+            });
+        });
     }
-    
 
     if (enabledOpts[Option::Relocate]) {
         // Relocate a few files.
         std::cout << "Relocating misplaced videos..." << std::endl;
-        for (auto& video : videoList) {
-            video->relocate(outDir);
-        }
+        Database db(fs::path("library.db"), dbProfile);
+        relocate(db, clipList);
+        clipList.clear();
+        std::clog << relocated << " videos relocated: " << bytesMoved << " bytes moved, ";
+        std::clog << bytesCopied << " bytes copied, " << relocationsFailed << " failed." << std::endl;
+    }
+    
+    if (enabledOpts[Option::Dupes]) {
+        std::cout << "Looking for duplicate videos..." << std::endl;
+        DuplicateFinder finder(pipelineOpts.workers);
+        DuplicateFinder::writeReport(std::cout, finder.find(dupesDir));
+    }
 
-        // Clean up the videoList before exiting
-        for (auto& video : videoList) {
-            delete video;
-        }
+    if (enabledOpts[Option::Queue]) {
+        std::cout << "Writing transcode queues..." << std::endl;
+        Database db(fs::path("library.db"), dbProfile);
+        TranscodeQueue::write(db, queuePrefix, queueOpts);
+    }
 
-        // Clean up the moddList before exiting
-        for (auto& modd : moddList) {
-            delete modd;
-        }
+    if (enabledOpts[Option::Export]) {
+        std::cout << "Exporting catalog snapshot..." << std::endl;
+        Database db(fs::path("library.db"), dbProfile);
+        SnapshotWriter::write(db, snapshotPath);
     }
-    
+
     std::cout << "Done!" << std::endl;
 
+    if (enabledOpts[Option::Stats]) {
+        statsReporter.reset();
+        Stats::global().writeJson(std::cerr);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "BatchHasher.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+static const std::size_t NO_RANGE = static_cast<std::size_t>(-1);
+
+/**
+ * @param engine engine to read through. Must outlive the hasher.
+*/
+BatchHasher::BatchHasher(ReadEngine& engine) : m_engine(engine), m_active(0) {
+    unsigned int capacity = std::min(engine.depth(), engine.bufferCount());
+    this->m_readAhead = std::min(IO_READ_AHEAD, capacity);
+    this->m_slots.resize(capacity / this->m_readAhead);
+    this->m_chunks.resize(this->m_slots.size() * this->m_readAhead);
+    for (auto& slot : this->m_slots) {
+        slot.active = false;
+        slot.sha256 = EVP_MD_CTX_new();
+        if (slot.sha256 == nullptr) {
+            this->freeContexts();
+            throw std::runtime_error("Failed to allocate SHA-256 context");
+        }
+    }
+}
+
+void BatchHasher::freeContexts() {
+    for (auto& slot : this->m_slots) {
+        EVP_MD_CTX_free(slot.sha256);
+        slot.sha256 = nullptr;
+    }
+}
+
+/**
+ * Abandons any files still being hashed, waiting for their reads to land first so
+ * nothing is written into the engine's buffers afterwards.
+*/
+BatchHasher::~BatchHasher() {
+    for (std::size_t i = 0; i < this->m_slots.size(); i++) {
+        Slot& slot = this->m_slots[i];
+        if (!slot.active) continue;
+        slot.failed = true;
+        if (slot.inFlight == 0) this->finish(slot);
+    }
+
+    try {
+        while (this->m_active > 0) {
+            this->complete(this->m_engine.wait());
+        }
+    } catch (const std::exception&) {
+        for (auto& slot : this->m_slots) {
+            if (slot.active) close(slot.fd);
+        }
+    }
+    this->freeContexts();
+}
+
+/**
+ * @return true if another file can be started.
+*/
+bool BatchHasher::canStart() const {
+    return this->m_active < this->m_slots.size();
+}
+
+/**
+ * @return true if no file is being hashed or waiting to be returned by next().
+*/
+bool BatchHasher::idle() const {
+    return this->m_active == 0 && this->m_results.empty();
+}
+
+/**
+ * Starts hashing a file. Only call when canStart() is true.
+ * A file that can't be opened is reported as failed by next().
+ * @param path file to hash.
+ * @param strategy which parts of the file to cover.
+ * @param tag returned by next() with the file's hash.
+*/
+void BatchHasher::start(const fs::path& path, HashStrategy strategy, uint64_t tag) {
+    auto slot = std::find_if(this->m_slots.begin(), this->m_slots.end(), [](const Slot& s) { return !s.active; });
+    if (slot == this->m_slots.end()) {
+        throw std::logic_error("No free hashing slot");
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat fileStat;
+    if (fd >= 0 && fstat(fd, &fileStat) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        this->m_results.push_back({tag, Hash(), false});
+        return;
+    }
+
+    uint64_t fileSize = fileStat.st_size;
+    slot->plan = Fingerprint::plan(strategy, fileSize);
+    // Nothing lies past the end of the file, so don't spend reads finding that out.
+    for (auto& range : slot->plan.ranges) {
+        range.second = range.first < fileSize ? std::min(range.second, fileSize - range.first) : 0;
+    }
+    if (strategy == HashStrategy::FULL) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    slot->active = true;
+    slot->fd = fd;
+    slot->tag = tag;
+    slot->range = 0;
+    slot->issued = 0;
+    slot->truncated = NO_RANGE;
+    slot->order.clear();
+    slot->nextBuffer = 0;
+    slot->inFlight = 0;
+    slot->failed = false;
+    EVP_DigestInit_ex(slot->sha256, EVP_sha256(), nullptr);
+    EVP_DigestUpdate(slot->sha256, slot->plan.prefix, slot->plan.prefixSize);
+    this->m_active++;
+
+    std::size_t slotIndex = slot - this->m_slots.begin();
+    this->issue(slotIndex);
+    if (slot->order.empty()) {
+        this->finish(*slot);
+    }
+}
+
+/**
+ * Waits for a file to finish hashing. Only call when idle() is false.
+ * @param hash receives the file's hash.
+ * @param ok set to false if the file couldn't be read, in which case hash is empty.
+ * @return the tag the file was started with.
+*/
+uint64_t BatchHasher::next(Hash& hash, bool& ok) {
+    while (this->m_results.empty()) {
+        if (this->m_active == 0) {
+            throw std::logic_error("No files are being hashed");
+        }
+        this->complete(this->m_engine.wait());
+    }
+
+    Result& result = this->m_results.front();
+    uint64_t tag = result.tag;
+    hash = std::move(result.hash);
+    ok = result.ok;
+    this->m_results.pop_front();
+    return tag;
+}
+
+/**
+ * Tops a file's reads in flight back up to the read-ahead, in file order.
+*/
+void BatchHasher::issue(std::size_t slotIndex) {
+    Slot& slot = this->m_slots[slotIndex];
+    const auto& ranges = slot.plan.ranges;
+
+    while (!slot.failed && slot.order.size() < this->m_readAhead) {
+        while (slot.range < ranges.size() && (slot.issued >= ranges[slot.range].second || slot.range == slot.truncated)) {
+            slot.range++;
+            slot.issued = 0;
+        }
+        if (slot.range >= ranges.size()) break;
+
+        std::size_t bufferIndex = slotIndex * this->m_readAhead + slot.nextBuffer++ % this->m_readAhead;
+        Chunk& chunk = this->m_chunks[bufferIndex];
+        chunk.range = slot.range;
+        chunk.offset = ranges[slot.range].first + slot.issued;
+        chunk.length = static_cast<uint32_t>(std::min<uint64_t>(IO_BUFFER_SIZE, ranges[slot.range].second - slot.issued));
+        chunk.filled = 0;
+        chunk.done = false;
+        slot.issued += chunk.length;
+
+        slot.order.push_back(bufferIndex);
+        this->submit(bufferIndex, slot.fd);
+        slot.inFlight++;
+    }
+}
+
+/**
+ * Requests whatever part of a chunk hasn't been read yet.
+*/
+void BatchHasher::submit(std::size_t bufferIndex, int fd) {
+    const Chunk& chunk = this->m_chunks[bufferIndex];
+    ReadRequest request;
+    request.fd = fd;
+    request.offset = chunk.offset + chunk.filled;
+    request.length = chunk.length - chunk.filled;
+    request.data = this->m_engine.buffer(bufferIndex) + chunk.filled;
+    request.buffer = bufferIndex;
+    request.tag = bufferIndex;
+    this->m_engine.submit(request);
+}
+
+/**
+ * Applies one read completion to its chunk, reissuing the rest of a short read.
+*/
+void BatchHasher::complete(const ReadCompletion& completion) {
+    std::size_t bufferIndex = completion.tag;
+    std::size_t slotIndex = bufferIndex / this->m_readAhead;
+    Slot& slot = this->m_slots[slotIndex];
+    Chunk& chunk = this->m_chunks[bufferIndex];
+    slot.inFlight--;
+
+    if (slot.failed || completion.result == 0 || chunk.range == slot.truncated) {
+        chunk.done = true;
+    } else if (completion.result == -EINTR || completion.result == -EAGAIN) {
+        this->submit(bufferIndex, slot.fd);
+        slot.inFlight++;
+    } else if (completion.result < 0) {
+        slot.failed = true;
+        chunk.done = true;
+    } else {
+        chunk.filled += completion.result;
+        if (chunk.filled < chunk.length) {
+            this->submit(bufferIndex, slot.fd);
+            slot.inFlight++;
+        } else {
+            chunk.done = true;
+        }
+    }
+
+    this->advance(slotIndex);
+}
+
+/**
+ * Hashes a file's chunks that are now contiguous with what has been hashed so far,
+ * then issues more reads, or finishes the file once nothing is left.
+*/
+void BatchHasher::advance(std::size_t slotIndex) {
+    Slot& slot = this->m_slots[slotIndex];
+    if (slot.failed) {
+        if (slot.inFlight == 0) this->finish(slot);
+        return;
+    }
+
+    while (!slot.order.empty() && this->m_chunks[slot.order.front()].done) {
+        std::size_t bufferIndex = slot.order.front();
+        const Chunk& chunk = this->m_chunks[bufferIndex];
+        if (chunk.range != slot.truncated) {
+            EVP_DigestUpdate(slot.sha256, this->m_engine.buffer(bufferIndex), chunk.filled);
+            Stats::global().add(Counter::BYTES_READ, chunk.filled);
+            Stats::global().add(Counter::BYTES_HASHED, chunk.filled);
+            // The file shrank since fstat; the rest of this range is gone, as with pread.
+            if (chunk.filled < chunk.length) slot.truncated = chunk.range;
+        }
+        slot.order.pop_front();
+    }
+
+    this->issue(slotIndex);
+    if (slot.order.empty()) {
+        this->finish(slot);
+    }
+}
+
+/**
+ * Closes a file and queues its result.
+*/
+void BatchHasher::finish(Slot& slot) {
+    close(slot.fd);
+    Result result = {slot.tag, Hash(), !slot.failed};
+    if (result.ok) {
+        unsigned int length = 0;
+        result.hash.resize(EVP_MAX_MD_SIZE);
+        EVP_DigestFinal_ex(slot.sha256, result.hash.data(), &length);
+        result.hash.resize(length);
+    }
+    this->m_results.push_back(std::move(result));
+    slot.order.clear();
+    slot.active = false;
+    this->m_active--;
+}
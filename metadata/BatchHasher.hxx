@@ -0,0 +1,100 @@
+#ifndef MEMORY_REPLAY_BATCH_HASHER_HXX
+#define MEMORY_REPLAY_BATCH_HASHER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <vector>
+
+extern "C" {
+#include <openssl/evp.h>
+};
+
+#include "Fingerprint.hxx"
+#include "ReadEngine.hxx"
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const unsigned int IO_READ_AHEAD = 4;    // Reads kept in flight per file
+
+    /**
+     * Hashes many files at once over a ReadEngine.
+     *
+     * Each file being hashed holds IO_READ_AHEAD of the engine's buffers and keeps that
+     * many reads in flight. Completions arrive in any order; each file's SHA-256 context
+     * is fed its chunks in file order as soon as they are contiguous, so the device sees
+     * up to depth() reads at once while hashes come out the same as Fingerprint::compute.
+     *
+     * Like the engine, a BatchHasher is used from one thread.
+    */
+    class BatchHasher {
+    public:
+        explicit BatchHasher(ReadEngine& engine);
+        ~BatchHasher();
+
+        BatchHasher(const BatchHasher&) = delete;
+        BatchHasher& operator=(const BatchHasher&) = delete;
+
+        bool canStart() const;
+        bool idle() const;
+
+        void start(const fs::path& path, HashStrategy strategy, uint64_t tag);
+        uint64_t next(Hash& hash, bool& ok);
+    private:
+        /**
+         * One read-ahead buffer's worth of a file.
+        */
+        struct Chunk {
+            std::size_t range;      // Index into the file's HashPlan ranges
+            uint64_t    offset;
+            uint32_t    length;
+            uint32_t    filled;
+            bool        done;       // Filled, or stopped short at end of file
+        };
+
+        /**
+         * A file being hashed.
+        */
+        struct Slot {
+            bool                    active;
+            int                     fd;
+            uint64_t                tag;
+            EVP_MD_CTX*             sha256;         // Owned. Reused for every file the slot hashes
+            HashPlan                plan;
+            std::size_t             range;          // Range being issued
+            uint64_t                issued;         // Bytes of that range issued so far
+            std::size_t             truncated;      // Range that hit end of file early
+            std::deque<std::size_t> order;          // Buffers in flight, in file order
+            std::size_t             nextBuffer;
+            unsigned int            inFlight;
+            bool                    failed;
+        };
+
+        /**
+         * A finished file waiting to be returned by next().
+        */
+        struct Result {
+            uint64_t    tag;
+            Hash        hash;
+            bool        ok;
+        };
+
+        ReadEngine&             m_engine;
+        unsigned int            m_readAhead;
+        std::vector<Slot>       m_slots;
+        std::vector<Chunk>      m_chunks;       // Indexed by engine buffer
+        std::deque<Result>      m_results;
+        std::size_t             m_active;
+
+        void issue(std::size_t slotIndex);
+        void submit(std::size_t bufferIndex, int fd);
+        void complete(const ReadCompletion& completion);
+        void advance(std::size_t slotIndex);
+        void finish(Slot& slot);
+        void freeContexts();
+    };
+};
+
+#endif // MEMORY_REPLAY_BATCH_HASHER_HXX
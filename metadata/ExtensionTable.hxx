@@ -0,0 +1,112 @@
+#ifndef MEMORY_REPLAY_EXTENSION_TABLE_HXX
+#define MEMORY_REPLAY_EXTENSION_TABLE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace memory_replay {
+    /**
+     * Case-insensitive set of file extensions, looked up through a perfect hash built at
+     * compile time.
+     *
+     * The constructor searches for a hash seed under which every extension lands in its
+     * own slot, so a lookup is one hash of the candidate and at most one comparison, with
+     * no allocation. Construct tables constexpr so a key set with no usable seed fails
+     * to compile rather than at startup.
+    */
+    template<std::size_t N>
+    class ExtensionTable {
+        static_assert(N > 0 && N < 127, "Slots store key indexes as int8_t");
+    public:
+        static constexpr std::size_t SLOT_BITS = N < 8 ? 4 : N < 32 ? 6 : 8;   // At least twice N slots
+        static constexpr std::size_t SLOTS = std::size_t(1) << SLOT_BITS;
+        static constexpr std::size_t MAX_LENGTH = 16;                            // Longest key accepted
+
+        /**
+         * @param keys extensions including the leading dot, in lower case.
+        */
+        constexpr explicit ExtensionTable(const char* const (&keys)[N]) : m_keys{}, m_lengths{}, m_slots{}, m_seed(0) {
+            for (std::size_t i = 0; i < N; i++) {
+                this->m_keys[i] = keys[i];
+                while (keys[i][this->m_lengths[i]] != '\0') this->m_lengths[i]++;
+                if (this->m_lengths[i] > MAX_LENGTH) throw std::logic_error("Extension too long");
+            }
+
+            for (uint32_t seed = 1; seed != 0; seed++) {
+                if (this->place(seed)) {
+                    this->m_seed = seed;
+                    return;
+                }
+            }
+            throw std::logic_error("No perfect hash seed for these extensions");
+        };
+
+        /**
+         * @param ext candidate extension including the leading dot, in any case.
+         * @param length length of ext.
+         * @param lowerCase set to true if ext matched exactly, false if only ignoring case.
+         * @return index of the matching key, or -1 if there is none.
+        */
+        constexpr int find(const char* ext, std::size_t length, bool& lowerCase) const {
+            if (length == 0 || length > MAX_LENGTH) return -1;
+
+            int index = this->m_slots[slot(ext, length, this->m_seed)] - 1;
+            if (index < 0 || this->m_lengths[index] != length) return -1;
+
+            lowerCase = true;
+            const char* key = this->m_keys[index];
+            for (std::size_t c = 0; c < length; c++) {
+                if (toLower(ext[c]) != key[c]) return -1;
+                lowerCase = lowerCase && ext[c] == key[c];
+            }
+            return index;
+        };
+
+        int find(const std::string& ext, bool& lowerCase) const {
+            return this->find(ext.data(), ext.size(), lowerCase);
+        };
+
+        constexpr uint32_t seed() const { return this->m_seed; };
+    private:
+        const char*     m_keys[N];
+        std::size_t     m_lengths[N];
+        int8_t          m_slots[SLOTS];     // Key index plus one; 0 for an empty slot
+        uint32_t        m_seed;
+
+        static constexpr char toLower(char c) {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        };
+
+        /**
+         * FNV-1a over the lower-cased bytes, started from the seed. The slot comes from
+         * the high bits, which the final multiply mixes best.
+        */
+        static constexpr std::size_t slot(const char* ext, std::size_t length, uint32_t seed) {
+            uint32_t hash = 2166136261u ^ seed;
+            for (std::size_t c = 0; c < length; c++) {
+                hash = (hash ^ static_cast<uint8_t>(toLower(ext[c]))) * 16777619u;
+            }
+            return hash >> (32 - SLOT_BITS);
+        };
+
+        /**
+         * Fills the slots under a seed.
+         * @return false if two keys collide.
+        */
+        constexpr bool place(uint32_t seed) {
+            for (std::size_t s = 0; s < SLOTS; s++) {
+                this->m_slots[s] = 0;
+            }
+            for (std::size_t i = 0; i < N; i++) {
+                std::size_t s = slot(this->m_keys[i], this->m_lengths[i], seed);
+                if (this->m_slots[s] != 0) return false;
+                this->m_slots[s] = static_cast<int8_t>(i + 1);
+            }
+            return true;
+        };
+    };
+};
+
+#endif // MEMORY_REPLAY_EXTENSION_TABLE_HXX
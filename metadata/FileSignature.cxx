@@ -0,0 +1,26 @@
+extern "C" {
+#include <sys/stat.h>
+};
+
+#include "FileSignature.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Takes the signature of a file.
+ * @param path file to stat.
+ * @param signature receives the signature on success.
+ * @return false if the file could not be stat'ed.
+*/
+bool FileSignature::read(const fs::path& path, FileSignature& signature) {
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0) {
+        return false;
+    }
+
+    signature.device = fileStat.st_dev;
+    signature.inode = fileStat.st_ino;
+    signature.size = fileStat.st_size;
+    signature.mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+    return true;
+}
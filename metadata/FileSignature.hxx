@@ -0,0 +1,30 @@
+#ifndef MEMORY_REPLAY_FILE_SIGNATURE_HXX
+#define MEMORY_REPLAY_FILE_SIGNATURE_HXX
+
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    /**
+     * Cheap identity of a file on disk, taken from stat(2).
+     * If none of these fields changed, the file's contents are assumed unchanged too.
+    */
+    struct FileSignature {
+        uint64_t    device;     // st_dev
+        uint64_t    inode;      // st_ino
+        uint64_t    size;       // st_size in bytes
+        int64_t     mtimeNs;    // st_mtim in nanoseconds since the Unix epoch
+
+        static bool read(const fs::path& path, FileSignature& signature);
+
+        bool operator==(const FileSignature& other) const {
+            return this->device == other.device && this->inode == other.inode &&
+                this->size == other.size && this->mtimeNs == other.mtimeNs;
+        };
+        bool operator!=(const FileSignature& other) const { return !(*this == other); };
+    };
+};
+
+#endif // MEMORY_REPLAY_FILE_SIGNATURE_HXX
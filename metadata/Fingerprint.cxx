@@ -0,0 +1,153 @@
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+
+extern "C" {
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "Fingerprint.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Reads up to length bytes at offset into buf, retrying short reads.
+ * @return number of bytes read. Less than length only at end of file.
+*/
+static std::size_t readAt(int fd, uint8_t* buf, std::size_t length, uint64_t offset) {
+    std::size_t total = 0;
+    while (total < length) {
+        ssize_t count = pread(fd, buf + total, length - total, offset + total);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            throw std::runtime_error("Failed to read video file");
+        }
+        if (count == 0) break;
+        total += count;
+    }
+    return total;
+}
+
+/**
+ * Hashes length bytes of the file starting at offset, in buffer-sized chunks.
+*/
+static void hashRange(EVP_MD_CTX* sha256, int fd, std::vector<uint8_t>& buffer, uint64_t offset, uint64_t length) {
+    while (length > 0) {
+        std::size_t chunk = length < buffer.size() ? length : buffer.size();
+        std::size_t count = readAt(fd, buffer.data(), chunk, offset);
+        EVP_DigestUpdate(sha256, buffer.data(), count);
+        Stats::global().add(Counter::BYTES_READ, count);
+        Stats::global().add(Counter::BYTES_HASHED, count);
+        if (count < chunk) break;
+        offset += count;
+        length -= count;
+    }
+}
+
+/**
+ * Hashes a video file.
+ * @param path file to hash.
+ * @param strategy which parts of the file to cover.
+ * @return SHA-256 digest.
+*/
+Hash Fingerprint::compute(const fs::path& path, HashStrategy strategy) {
+    static thread_local std::vector<uint8_t> buffer(READ_SIZE);
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open video file");
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat video file");
+    }
+    uint64_t fileSize = fileStat.st_size;
+
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> sha256(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+    if (!sha256 || EVP_DigestInit_ex(sha256.get(), EVP_sha256(), nullptr) != 1) {
+        close(fd);
+        throw std::runtime_error("Failed to start SHA-256");
+    }
+
+    HashPlan hashPlan = plan(strategy, fileSize);
+    EVP_DigestUpdate(sha256.get(), hashPlan.prefix, hashPlan.prefixSize);
+    if (strategy == HashStrategy::FULL) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    try {
+        for (const auto& range : hashPlan.ranges) {
+            hashRange(sha256.get(), fd, buffer, range.first, range.second);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    Hash hash(EVP_MAX_MD_SIZE);
+    unsigned int length = 0;
+    EVP_DigestFinal_ex(sha256.get(), hash.data(), &length);
+    hash.resize(length);
+    return hash;
+}
+
+/**
+ * Works out which bytes a strategy covers, so every reader hashes exactly the same data.
+ * @param strategy which parts of the file to cover.
+ * @param fileSize size of the file in bytes.
+*/
+HashPlan Fingerprint::plan(HashStrategy strategy, uint64_t fileSize) {
+    HashPlan hashPlan;
+    hashPlan.prefixSize = 0;
+
+    switch (strategy) {
+        case HashStrategy::LEGACY:
+        case HashStrategy::HEAD:
+            hashPlan.ranges.emplace_back(0, READ_SIZE);
+            break;
+        case HashStrategy::SAMPLED:
+            // Mixing in the size separates files that only differ past the samples' reach.
+            for (std::size_t i = 0; i < sizeof(fileSize); i++) {
+                hashPlan.prefix[i] = static_cast<uint8_t>(fileSize >> (8 * i));
+            }
+            hashPlan.prefixSize = sizeof(fileSize);
+
+            if (fileSize <= 3 * static_cast<uint64_t>(SAMPLE_SIZE)) {
+                hashPlan.ranges.emplace_back(0, fileSize);
+            } else {
+                hashPlan.ranges.emplace_back(0, SAMPLE_SIZE);
+                hashPlan.ranges.emplace_back((fileSize - SAMPLE_SIZE) / 2, SAMPLE_SIZE);
+                hashPlan.ranges.emplace_back(fileSize - SAMPLE_SIZE, SAMPLE_SIZE);
+            }
+            break;
+        case HashStrategy::FULL:
+            hashPlan.ranges.emplace_back(0, fileSize);
+            break;
+    }
+
+    return hashPlan;
+}
+
+/**
+ * Converts a command line strategy name ("head", "sampled" or "full") to a HashStrategy.
+ * @return false if the name isn't recognized.
+*/
+bool Fingerprint::parseStrategy(const std::string& name, HashStrategy& strategy) {
+    if (name == "head") {
+        strategy = HashStrategy::HEAD;
+    } else if (name == "sampled") {
+        strategy = HashStrategy::SAMPLED;
+    } else if (name == "full") {
+        strategy = HashStrategy::FULL;
+    } else {
+        return false;
+    }
+    return true;
+}
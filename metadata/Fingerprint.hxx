@@ -0,0 +1,54 @@
+#ifndef MEMORY_REPLAY_FINGERPRINT_HXX
+#define MEMORY_REPLAY_FINGERPRINT_HXX
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    typedef std::vector<uint8_t> Hash;
+
+    static const uint32_t READ_SIZE = 5120000;      // 5MiB. Bytes hashed by HashStrategy::HEAD
+    static const uint32_t SAMPLE_SIZE = 1048576;    // 1MiB. Bytes hashed per HashStrategy::SAMPLED sample
+
+    /**
+     * Which parts of a video file its hash covers. Stored with every hash, so the
+     * numeric values must never change.
+    */
+    enum class HashStrategy {
+        LEGACY = 0,     // Hashed before strategies were recorded.
+        HEAD = 1,       // First READ_SIZE bytes.
+        SAMPLED = 2,    // File size plus SAMPLE_SIZE bytes from the head, middle and tail.
+        FULL = 3        // Every byte of the file.
+    };
+
+    /**
+     * The bytes a HashStrategy feeds to SHA-256, in order.
+     * Ranges may run past the end of the file; reading stops at end of file.
+    */
+    struct HashPlan {
+        uint8_t                                     prefix[8];  // Hashed before any file data
+        std::size_t                                 prefixSize;
+        std::vector<std::pair<uint64_t, uint64_t>>  ranges;     // (offset, length) pairs
+    };
+
+    /**
+     * Computes content hashes of video files.
+     *
+     * Reads go through pread(2) into a buffer each thread reuses between files, and only
+     * the bytes actually read are hashed, so results are deterministic for a given file.
+    */
+    class Fingerprint {
+    public:
+        static Hash compute(const fs::path& path, HashStrategy strategy);
+        static HashPlan plan(HashStrategy strategy, uint64_t fileSize);
+
+        static bool parseStrategy(const std::string& name, HashStrategy& strategy);
+    };
+};
+
+#endif // MEMORY_REPLAY_FINGERPRINT_HXX
@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "MediaProbe.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+static uint16_t readLe16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t readBe32(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static uint64_t readBe64(const uint8_t* data) {
+    return (static_cast<uint64_t>(readBe32(data)) << 32) | readBe32(data + 4);
+}
+
+static bool hasTag(const uint8_t* data, const char* tag) {
+    return std::memcmp(data, tag, 4) == 0;
+}
+
+/**
+ * Reads exactly count bytes at offset, or as many as the file holds.
+ * @return bytes read.
+*/
+static std::size_t readAt(int fd, uint8_t* buffer, std::size_t count, uint64_t offset) {
+    std::size_t total = 0;
+    while (total < count) {
+        ssize_t bytes = pread(fd, buffer + total, count - total, offset + total);
+        if (bytes <= 0) {
+            break;
+        }
+        total += bytes;
+    }
+    Stats::global().add(Counter::BYTES_READ, total);
+    return total;
+}
+
+/**
+ * Looks through MPEG-PS start codes for an MPEG-2 sequence extension and AC3 audio
+ * carried in private stream 1.
+*/
+static void probeMpegPs(const uint8_t* data, std::size_t size, ProbeResult& result) {
+    result.container = Container::MPEG;
+    for (std::size_t i = 0; i + 4 < size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+
+        uint8_t code = data[i + 3];
+        if (code == 0xB5 && (data[i + 4] >> 4) == 1) {
+            // Sequence extension. Only MPEG-2 streams carry one.
+            result.videoCodec = VideoCodec::MPEG2;
+        } else if (code == 0xBD && i + 9 < size) {
+            // Private stream 1. The first payload byte is the substream id; 0x80-0x87 is AC3.
+            std::size_t payload = i + 9 + data[i + 8];
+            if (payload < size && data[payload] >= 0x80 && data[payload] <= 0x87) {
+                result.audioCodec = AudioCodec::AC3;
+            }
+        }
+
+        if (result.videoCodec != VideoCodec::UNKNOWN && result.audioCodec != AudioCodec::UNKNOWN) {
+            return;
+        }
+    }
+}
+
+/**
+ * Maps an MP4 sample entry type to a codec.
+*/
+static void classifyMp4Sample(const uint8_t* type, ProbeResult& result) {
+    if (hasTag(type, "avc1") || hasTag(type, "avc3")) {
+        result.videoCodec = VideoCodec::X264;
+    } else if (hasTag(type, "hvc1") || hasTag(type, "hev1")) {
+        result.videoCodec = VideoCodec::X265;
+    } else if (hasTag(type, "mp4a")) {
+        result.audioCodec = AudioCodec::AAC;
+    } else if (hasTag(type, "ac-3")) {
+        result.audioCodec = AudioCodec::AC3;
+    }
+}
+
+/**
+ * Walks the MP4 boxes between start and end, descending through the containers that
+ * lead to each track's sample description. Only box headers are read.
+ *
+ * @param budget box headers left to read. Stops the walk on malformed files.
+*/
+static void walkMp4(int fd, uint64_t start, uint64_t end, int& budget, ProbeResult& result) {
+    uint8_t header[16];
+    uint64_t offset = start;
+    while (offset + 8 <= end && budget-- > 0) {
+        if (readAt(fd, header, sizeof(header), offset) < 8) {
+            return;
+        }
+
+        uint64_t size = readBe32(header);
+        uint64_t headerSize = 8;
+        if (size == 1) {
+            size = readBe64(header + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - offset;
+        }
+        if (size < headerSize || offset + size > end) {
+            return;
+        }
+
+        const uint8_t* type = header + 4;
+        if (hasTag(type, "moov") || hasTag(type, "trak") || hasTag(type, "mdia") ||
+                hasTag(type, "minf") || hasTag(type, "stbl")) {
+            walkMp4(fd, offset + headerSize, offset + size, budget, result);
+        } else if (hasTag(type, "stsd")) {
+            // Version and flags, entry count, then the first entry's size and type.
+            uint8_t entry[16];
+            if (size >= headerSize + sizeof(entry) && readAt(fd, entry, sizeof(entry), offset + headerSize) == sizeof(entry)) {
+                classifyMp4Sample(entry + 12, result);
+            }
+        }
+
+        offset += size;
+    }
+}
+
+/**
+ * Reads Matroska CodecID elements out of the head of the file.
+*/
+static void probeMatroska(const uint8_t* data, std::size_t size, ProbeResult& result) {
+    result.container = Container::MKV;
+    for (std::size_t i = 0; i + 2 < size; i++) {
+        // CodecID is element 0x86 with a one byte size for any id worth matching.
+        if (data[i] != 0x86 || (data[i + 1] & 0x80) == 0) {
+            continue;
+        }
+        std::size_t length = data[i + 1] & 0x7F;
+        if (length < 3 || i + 2 + length > size) {
+            continue;
+        }
+
+        std::string_view codec(reinterpret_cast<const char*>(data + i + 2), length);
+        if (codec.compare(0, 7, "V_MPEG2") == 0) {
+            result.videoCodec = VideoCodec::MPEG2;
+        } else if (codec.compare(0, 15, "V_MPEG4/ISO/AVC") == 0) {
+            result.videoCodec = VideoCodec::X264;
+        } else if (codec.compare(0, 16, "V_MPEGH/ISO/HEVC") == 0) {
+            result.videoCodec = VideoCodec::X265;
+        } else if (codec.compare(0, 5, "A_AC3") == 0) {
+            result.audioCodec = AudioCodec::AC3;
+        } else if (codec.compare(0, 5, "A_AAC") == 0) {
+            result.audioCodec = AudioCodec::AAC;
+        } else if (codec.compare(0, 8, "A_VORBIS") == 0) {
+            result.audioCodec = AudioCodec::VORBIS;
+        }
+    }
+}
+
+/**
+ * Maps an AVI video FOURCC to a codec, ignoring case.
+*/
+static VideoCodec classifyAviVideo(const uint8_t* fourcc) {
+    char upper[4];
+    for (int i = 0; i < 4; i++) {
+        upper[i] = (fourcc[i] >= 'a' && fourcc[i] <= 'z') ? fourcc[i] - ('a' - 'A') : fourcc[i];
+    }
+    std::string_view tag(upper, 4);
+    if (tag == "H264" || tag == "X264" || tag == "AVC1") {
+        return VideoCodec::X264;
+    } else if (tag == "HEVC" || tag == "H265" || tag == "X265" || tag == "HVC1") {
+        return VideoCodec::X265;
+    } else if (tag == "MPG2" || tag == "MPEG") {
+        return VideoCodec::MPEG2;
+    }
+    return VideoCodec::UNKNOWN;
+}
+
+/**
+ * Reads the stream headers of an AVI file. Each strh is followed by a strf holding
+ * a BITMAPINFOHEADER for video or a WAVEFORMATEX for audio.
+*/
+static void probeAvi(const uint8_t* data, std::size_t size, ProbeResult& result) {
+    result.container = Container::AVI;
+    for (std::size_t i = 12; i + 16 <= size; i++) {
+        if (!hasTag(data + i, "strh")) {
+            continue;
+        }
+        const uint8_t* streamType = data + i + 8;
+
+        std::size_t strf = i + 8 + (data[i + 4] | (data[i + 5] << 8) | (data[i + 6] << 16));
+        bool hasFormat = strf + 8 + 20 <= size && hasTag(data + strf, "strf");
+
+        if (hasTag(streamType, "vids")) {
+            // biCompression is more reliable than the stream handler, which is often blank.
+            VideoCodec codec = hasFormat ? classifyAviVideo(data + strf + 8 + 16) : VideoCodec::UNKNOWN;
+            result.videoCodec = codec != VideoCodec::UNKNOWN ? codec : classifyAviVideo(streamType + 4);
+        } else if (hasTag(streamType, "auds") && hasFormat) {
+            uint16_t formatTag = readLe16(data + strf + 8);
+            if (formatTag == 0x2000) {
+                result.audioCodec = AudioCodec::AC3;
+            } else if (formatTag == 0x00FF || formatTag == 0x1600 || formatTag == 0x1610) {
+                result.audioCodec = AudioCodec::AAC;
+            } else if ((formatTag >= 0x674F && formatTag <= 0x6751) || (formatTag >= 0x676F && formatTag <= 0x6771)) {
+                result.audioCodec = AudioCodec::VORBIS;
+            }
+        }
+    }
+}
+
+/**
+ * Earliest and latest timestamps seen in a window of an MPEG program stream.
+*/
+struct Timestamps {
+    uint64_t    minPts;
+    uint64_t    maxPts;
+    uint64_t    minScr;
+    uint64_t    maxScr;
+    bool        hasPts;
+    bool        hasScr;
+};
+
+/**
+ * Decodes a 33 bit PTS from its five byte '001x' marker form.
+*/
+static uint64_t readPts(const uint8_t* data) {
+    return (static_cast<uint64_t>((data[0] >> 1) & 0x07) << 30) | (data[1] << 22) |
+        ((data[2] >> 1) << 15) | (data[3] << 7) | (data[4] >> 1);
+}
+
+static void addTimestamp(uint64_t value, uint64_t& minValue, uint64_t& maxValue, bool& seen) {
+    minValue = seen ? std::min(minValue, value) : value;
+    maxValue = seen ? std::max(maxValue, value) : value;
+    seen = true;
+}
+
+/**
+ * Collects the pack SCRs and video PTSs in a window. Video frames are stored out of
+ * presentation order, so the extremes are kept rather than the first and last seen.
+*/
+static void scanTimestamps(const uint8_t* data, std::size_t size, Timestamps& stamps) {
+    for (std::size_t i = 0; i + 14 <= size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+
+        uint8_t code = data[i + 3];
+        const uint8_t* b = data + i + 4;
+        if (code == 0xBA) {
+            uint64_t scr;
+            if ((b[0] & 0xC0) == 0x40) {
+                // MPEG-2: '01' then SCR base split 3/15/15 around marker bits.
+                scr = (static_cast<uint64_t>((b[0] >> 3) & 0x07) << 30) | (static_cast<uint64_t>(b[0] & 0x03) << 28) |
+                    (b[1] << 20) | ((b[2] >> 3) << 15) | ((b[2] & 0x03) << 13) | (b[3] << 5) | (b[4] >> 3);
+            } else if ((b[0] & 0xF0) == 0x20) {
+                // MPEG-1: same layout as a PTS.
+                scr = readPts(b);
+            } else {
+                continue;
+            }
+            addTimestamp(scr, stamps.minScr, stamps.maxScr, stamps.hasScr);
+        } else if (code >= 0xE0 && code <= 0xEF) {
+            const uint8_t* header = b + 2;
+            const uint8_t* end = data + size;
+            if ((header[0] & 0xC0) == 0x80) {
+                // MPEG-2 PES header. PTS follows the header length when flagged.
+                if ((header[1] & 0x80) != 0 && header + 8 <= end) {
+                    addTimestamp(readPts(header + 3), stamps.minPts, stamps.maxPts, stamps.hasPts);
+                }
+            } else {
+                // MPEG-1 PES header: stuffing, an optional STD buffer size, then the PTS.
+                while (header < end && *header == 0xFF) header++;
+                if (header + 2 <= end && (*header & 0xC0) == 0x40) header += 2;
+                if (header + 5 <= end && (*header & 0xE0) == 0x20) {
+                    addTimestamp(readPts(header), stamps.minPts, stamps.maxPts, stamps.hasPts);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Measures an MPEG program stream's duration from its timestamps, reading only
+ * TIMESTAMP_WINDOW bytes at each end of the file.
+ *
+ * The span from the earliest video PTS in the head to the latest in the tail is used,
+ * falling back to the pack SCRs when the windows hold no video PTS.
+ *
+ * @param path MPEG-PS file to measure.
+ * @param seconds receives the duration.
+ * @return false if the file can't be read, either window has no timestamps, or they
+ *         don't span any time.
+*/
+bool MediaProbe::mpegDuration(const fs::path& path, double& seconds) {
+    static thread_local std::vector<uint8_t> buffer(TIMESTAMP_WINDOW);
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return false;
+    }
+    uint64_t fileSize = fileStat.st_size;
+
+    // Small files fit in one window, which then serves as both head and tail.
+    Timestamps head = {0, 0, 0, 0, false, false};
+    std::size_t size = readAt(fd, buffer.data(), std::min<uint64_t>(TIMESTAMP_WINDOW, fileSize), 0);
+    scanTimestamps(buffer.data(), size, head);
+
+    Timestamps tail = head;
+    if (fileSize > TIMESTAMP_WINDOW) {
+        tail = {0, 0, 0, 0, false, false};
+        size = readAt(fd, buffer.data(), TIMESTAMP_WINDOW, fileSize - TIMESTAMP_WINDOW);
+        scanTimestamps(buffer.data(), size, tail);
+    }
+    close(fd);
+
+    uint64_t first;
+    uint64_t last;
+    if (head.hasPts && tail.hasPts) {
+        first = head.minPts;
+        last = tail.maxPts;
+    } else if (head.hasScr && tail.hasScr) {
+        first = head.minScr;
+        last = tail.maxScr;
+    } else {
+        return false;
+    }
+
+    // A single timestamp, or one seen at both ends, says nothing about the duration.
+    if (last == first) {
+        return false;
+    }
+
+    // Timestamps are 33 bits and wrap around. A tail behind the head is only a wrap if
+    // the span across it is plausible; otherwise the clock restarted mid-stream.
+    uint64_t ticks = (last - first) & ((static_cast<uint64_t>(1) << 33) - 1);
+    if (last < first && ticks > static_cast<uint64_t>(MPEG_MAX_WRAP_SECONDS) * MPEG_CLOCK_HZ) {
+        return false;
+    }
+    seconds = static_cast<double>(ticks) / MPEG_CLOCK_HZ;
+    return true;
+}
+
+/**
+ * Probes a video file.
+ * @param path file to probe.
+ * @param result receives the container and codecs. Codecs that weren't found are UNKNOWN.
+ * @return false if the file can't be read or its container isn't recognized.
+*/
+bool MediaProbe::probe(const fs::path& path, ProbeResult& result) {
+    static thread_local std::vector<uint8_t> buffer(PROBE_SIZE);
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return false;
+    }
+
+    std::size_t size = readAt(fd, buffer.data(), std::min<uint64_t>(PROBE_SIZE, fileStat.st_size), 0);
+    const uint8_t* data = buffer.data();
+
+    result.container = Container::UNKNOWN;
+    result.videoCodec = VideoCodec::UNKNOWN;
+    result.audioCodec = AudioCodec::UNKNOWN;
+
+    bool recognized = true;
+    if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 1 && data[3] == 0xBA) {
+        probeMpegPs(data, size, result);
+    } else if (size >= 8 && (hasTag(data + 4, "ftyp") || hasTag(data + 4, "moov"))) {
+        result.container = Container::MP4;
+        int budget = MP4_MAX_BOXES;
+        walkMp4(fd, 0, fileStat.st_size, budget, result);
+    } else if (size >= 4 && data[0] == 0x1A && data[1] == 0x45 && data[2] == 0xDF && data[3] == 0xA3) {
+        probeMatroska(data, size, result);
+    } else if (size >= 12 && hasTag(data, "RIFF") && hasTag(data + 8, "AVI ")) {
+        probeAvi(data, size, result);
+    } else {
+        recognized = false;
+    }
+
+    close(fd);
+    return recognized;
+}
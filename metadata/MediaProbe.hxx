@@ -0,0 +1,60 @@
+#ifndef MEMORY_REPLAY_MEDIA_PROBE_HXX
+#define MEMORY_REPLAY_MEDIA_PROBE_HXX
+
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const uint32_t PROBE_SIZE = 65536;   // 64KiB. Bytes read from the head of a file when probing
+    static const int MP4_MAX_BOXES = 256;       // Most MP4 box headers read while walking to the sample descriptions
+    static const uint32_t TIMESTAMP_WINDOW = 262144;    // 256KiB. Bytes read from each end of an MPEG-PS file for its timestamps
+    static const uint32_t MPEG_CLOCK_HZ = 90000;        // Ticks per second of SCR and PTS values
+    static const uint32_t MPEG_MAX_WRAP_SECONDS = 43200; // 12h. Longest span accepted across a timestamp wrap
+
+    /**
+     * Stored with every video, so the numeric values must never change.
+    */
+    enum class Container {
+        MPEG = 0,       // MPEG-1/2 container.
+        MP4 = 1,        // MPEG-4 container.
+        MKV = 2,        // Matroska container.
+        AVI = 3,        // AVI container.
+        UNKNOWN = 4     // Unsupported container.
+    };
+
+    enum class VideoCodec {
+        MPEG2 = 0,      // MPEG-2 video codec
+        X264 = 1,       // x264 video codec
+        X265 = 2,       // x265/HEVC video codec
+        UNKNOWN = 3     // Unsupported video codec
+    };
+
+    enum class AudioCodec {
+        AC3 = 0,        // AC3 audio codec
+        AAC = 1,        // AAC audio codec
+        VORBIS = 2,     // Vorbis audio codec
+        UNKNOWN = 3     // Unsupported audio codec
+    };
+
+    struct ProbeResult {
+        Container   container;
+        VideoCodec  videoCodec;
+        AudioCodec  audioCodec;
+    };
+
+    /**
+     * Identifies a video's container and codecs from its own bytes.
+     *
+     * Only the first PROBE_SIZE bytes are read, plus a handful of box headers for MP4
+     * files whose moov atom sits after the media data. Nothing is decoded.
+    */
+    class MediaProbe {
+    public:
+        static bool probe(const fs::path& path, ProbeResult& result);
+        static bool mpegDuration(const fs::path& path, double& seconds);
+    };
+};
+
+#endif // MEMORY_REPLAY_MEDIA_PROBE_HXX
@@ -1,188 +1,136 @@
+#include <cerrno>
+#include <charconv>
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <boost/algorithm/string.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
 
 #include "Modd.hxx"
+#include "PlistTokenizer.hxx"
+#include "Relocator.hxx"
+#include "../stats/Stats.hxx"
 
 using namespace memory_replay;
 
 Modd::Modd(const fs::path& moddFilePath) {
-    bool readArray = false;
+    this->m_checkCode = 0;
+    this->m_dateTimeOriginal = 0;
+    this->m_dateTimeActual = 0;
+    this->m_duration = 0;
+    this->m_fileSize = 0;
+
+    // The name of the modd is its file name
+    this->m_location = InternedPath(moddFilePath);
 
-    // Get the name of the modd file
-    this->m_name = moddFilePath.filename();
-    this->m_location = moddFilePath;
+    // Read the whole file once into a buffer this thread keeps between calls.
+    static thread_local std::vector<char> readBuf;
 
-    // Read the file in.
-    std::ifstream moddFile(moddFilePath.string(), std::ios::ate | std::ios::binary);
-    if (!moddFile.is_open()) {
+    int fd = open(moddFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
         throw std::runtime_error("Failed to open target file.");
     }
 
-    int numChars = moddFile.tellg();
-    moddFile.seekg(moddFile.beg);
-
-    std::vector<char> readBuf;
-    readBuf.resize(numChars + 1);
-    readBuf[numChars] = '\0';
-    moddFile.read(readBuf.data(), numChars);
-    
-    moddFile.close();
-
-    std::string notBuf = vecToString(readBuf);
-    std::stringstream moddTxt;
-    moddTxt << cleanText(notBuf);
-
-    std::string line;
-
-    while (std::getline(moddTxt, line)) {
-        bool readSuccess = moddTxt.rdstate() == std::ios_base::goodbit;
-        if (!(readSuccess)) {
-            break;
-        }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat target file.");
+    }
 
-        if (!readArray) {
-            std::size_t commaLoc = line.find(",");
-            std::string key = line.substr(0, commaLoc);
-            std::string value = line.substr(commaLoc+1);
-
-            if (key == "CheckCode") {
-                this->m_checkCode = std::stoul(value, nullptr, 16);
-            } else if (key == "DateTimeOriginal") {
-                this->m_dateTimeOriginal = std::stof(value, nullptr);
-                this->setActualTime(TimeZone::CST);
-            } else if (key == "Duration") {
-                this->m_duration = std::stof(value, nullptr);
-            } else if (key == "FileSize") {
-                this->m_fileSize = std::stoull(value, nullptr, 10);
-            } else if (key == "VTList") {
-                if (value == "[") {
-                    readArray = true;
-                }
-            } else {
-                // I can't track down why this is being funny.
-                // std::cout << "\nWeird file: " << moddFilePath.string() << std::endl;
-                // std::cout << "Parsing \'" << key << "\' not currently supported." << std::endl;
-            }
-        } else {
-            if (line.find("]") != std::string::npos) {
-                readArray = false;
-                continue;
-            }
-            this->m_vtList.push_back(new VT(line));
-        }
+    readBuf.resize(fileStat.st_size);
+    std::size_t numChars = 0;
+    while (numChars < readBuf.size()) {
+        ssize_t count = read(fd, readBuf.data() + numChars, readBuf.size() - numChars);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        numChars += count;
     }
+    close(fd);
+    Stats::global().add(Counter::BYTES_READ, numChars);
+
+    this->parse(std::string_view(readBuf.data(), numChars));
 }
 
-Modd::~Modd() {
-    for (auto& vt : this->m_vtList) {
-        delete vt;
+static void parseValue(std::string_view text, uint32_t& out, int base) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out, base);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Malformed modd value.");
     }
 }
 
-/**
- * Converts a char vector to a string.
- * @param txt char vector
- * @return string object made from txt
- */
-std::string Modd::vecToString(std::vector<char> txt) {
-    std::string result;
-
-    for (const auto& ltr : txt) {
-        result += ltr;
-        if (ltr == '\0') break;
+static void parseValue(std::string_view text, uint64_t& out) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Malformed modd value.");
     }
-
-    return result;
 }
 
-/**
- * Removes all superfluous text from the provided string.
- * @param moddText raw text from .modd file.
- * @param size number of characters in raw text.
- * @return processed string.
- */
-std::string Modd::cleanText(char* moddText, std::size_t size) {
-    std::string result;
-    result.copy(moddText, size);
-    return cleanText(result);
+static void parseValue(std::string_view text, float& out) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Malformed modd value.");
+    }
 }
 
 /**
- * Removes all superfluous text from the provided string.
+ * Pulls the supported fields out of the raw .modd text in a single forward scan.
  * @param moddText raw text from .modd file.
- * @return processed string.
- */
-std::string Modd::cleanText(std::string& moddText) {
-    // Start by removing the unneeded lines of the file
-    auto result = boost::algorithm::replace_first_copy(moddText, XML_HEADER, "");
-    boost::algorithm::replace_first(result, DATA_HEADER, "");
-    boost::algorithm::replace_first(result, DATA_FOOTER, "");
-
-    // Clean up tags
-    boost::algorithm::replace_all(result, "<key>", "");
-    boost::algorithm::replace_all(result, "</key>", ",");
-    boost::algorithm::replace_all(result, "<string>", "");
-    boost::algorithm::replace_all(result, "</string>", "\n");
-    boost::algorithm::replace_all(result, "<real>", "");
-    boost::algorithm::replace_all(result, "</real>", "\n");
-    boost::algorithm::replace_all(result, "<integer>", "");
-    boost::algorithm::replace_all(result, "</integer>", "\n");
-    boost::algorithm::replace_all(result, "<array>", "[\n");
-    boost::algorithm::replace_all(result, "</array>", "]");
-
-    boost::algorithm::trim_left(result);
-    boost::algorithm::trim_right(result);
-
-    return result;
-}
-
-std::string Modd::replaceFirst(std::string& s, const std::string& toReplace, const std::string& replaceWith) {
-    std::size_t pos = s.find(toReplace);
-    if (pos == std::string::npos) return s;
-    return s.replace(pos, toReplace.length(), replaceWith);
-}
-
-std::string Modd::replaceAll(std::string& s, const std::string& toReplace, const std::string& replaceWith) {
-    std::string result;
-    std::string old;
-    do {
-        old = result;
-        result = replaceFirst(s, toReplace, replaceWith);
-        s = result;
-    } while (result != old);
+*/
+void Modd::parse(std::string_view moddText) {
+    PlistTokenizer tokens(moddText);
+    std::string_view key;
+    std::string_view value;
+    PlistToken token;
+
+    while ((token = tokens.next(key)) != PlistToken::END) {
+        if (token != PlistToken::KEY) {
+            // Containers without a known key (e.g. MetaDataList) are walked into, not skipped.
+            continue;
+        }
 
-    return result;
+        token = tokens.next(value);
+        if (key == "CheckCode") {
+            parseValue(value, this->m_checkCode, 16);
+        } else if (key == "DateTimeOriginal") {
+            parseValue(value, this->m_dateTimeOriginal);
+            this->setActualTime(TimeZone::CST);
+        } else if (key == "Duration") {
+            parseValue(value, this->m_duration);
+        } else if (key == "FileSize") {
+            parseValue(value, this->m_fileSize);
+        } else if (key == "VTList" && token == PlistToken::ARRAY_BEGIN) {
+            while ((token = tokens.next(value)) != PlistToken::ARRAY_END) {
+                if (token == PlistToken::END) {
+                    throw std::runtime_error("Unterminated VTList.");
+                }
+                if (token == PlistToken::STRING) {
+                    this->m_vtList.emplace_back(value);
+                } else {
+                    tokens.skipValue(token);
+                }
+            }
+        }
+    }
 }
 
-bool Modd::relocate(const fs::path& outDir) {
-    bool success;
+RelocationResult Modd::relocate(const fs::path& outDir) {
     try {
-        success = fs::create_directories(outDir);
+        fs::create_directories(outDir);
     } catch (const fs::filesystem_error& e) {
         std::cerr << e.what() <<  std::endl;
     }
 
     fs::path outPath = outDir;
-    outPath.concat(this->m_name);
+    outPath.concat(this->m_location.name());
 
-    try {
-        success = fs::copy_file(this->m_location, outPath);
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << e.what() << std::endl;
+    RelocationResult result = Relocator::move(this->m_location.path(), outPath);
+    if (result.success) {
+        this->m_location = InternedPath(outPath);
     }
 
-    try{
-        if (success){
-            success = fs::remove(this->m_location);
-            this->m_location = outPath;
-        }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << e.what() << std::endl;
-    }
-
-    return success;
+    return result;
 }
 
 void Modd::setActualTime(const TimeZone& tz) {
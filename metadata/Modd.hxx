@@ -3,9 +3,13 @@
 
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <filesystem>
 #include <vector>
 
+#include "PathInterner.hxx"
+#include "Relocator.hxx"
+#include "Span.hxx"
 #include "VT.hxx"
 
 namespace fs = std::filesystem;
@@ -32,37 +36,29 @@ namespace memory_replay {
     public:
         explicit Modd(const fs::path& moddFilePath);
 
-        ~Modd();
-
-        bool relocate(const fs::path& outDir);
+        RelocationResult relocate(const fs::path& outDir);
 
         // Getters
-        std::string         getName()               const {return this->m_name;};
-        fs::path            getPath()               const {return this->m_location;};
+        const std::string&  getName()               const {return this->m_location.name();};
+        const InternedPath& getPath()               const {return this->m_location;};
         uint32_t            getCheckCode()          const {return this->m_checkCode;};
         float               getDateTimeOriginal()   const {return this->m_dateTimeOriginal;};
         uint64_t            getDateTimeActual()     const {return this->m_dateTimeActual;};
         float               getDuration()           const {return this->m_duration;};
         uint64_t            getFileSize()           const {return this->m_fileSize;};
-        std::vector<VT*>    getVTList()             const {return this->m_vtList;};
+        Span<const VT>      getVTList()             const {return Span<const VT>(this->m_vtList.data(), this->m_vtList.size());};
     protected:
         void setActualTime(const TimeZone& tz);
     private:
-        std::string         m_name;             // Derived from file name
-        fs::path            m_location;         // Location of .modd file in filesystem
+        InternedPath        m_location;         // Location of .modd file in filesystem. Its name is the modd's
         uint32_t            m_checkCode;        // Unknown hash algorithm
         float               m_dateTimeOriginal; // Measured in days since Dec. 30 1899
         uint64_t            m_dateTimeActual;   // Unix-standard version of m_dateTimeOriginal
         float               m_duration;         // Seconds in clip.
         uint64_t            m_fileSize;         // Size of file in bytes.
-        std::vector<VT*>    m_vtList;           // Unkown purpose. Potentially video timings
-
-        static std::string vecToString(std::vector<char> txt);
-        static std::string cleanText(char* moddText, std::size_t size);
-        static std::string cleanText(std::string& moddText);
+        std::vector<VT>     m_vtList;           // Unkown purpose. Potentially video timings
 
-        static std::string replaceFirst(std::string& s, const std::string& toReplace, const std::string& replaceWith);
-    static std::string replaceAll(std::string& s, const std::string& toReplace, const std::string& replaceWith);
+        void parse(std::string_view moddText);
     };
 
     inline std::ostream & operator<<(std::ostream & Str, const Modd & m) { 
@@ -70,9 +66,9 @@ namespace memory_replay {
         Str << m.getDateTimeOriginal() << ", DateTimeActual = " << m.getDateTimeActual() << ", Duration = ";
         Str << m.getDuration() << ", FileSize = " << m.getFileSize() << ", VTList = [";
 
-        const auto& vtList = m.getVTList();
+        auto vtList = m.getVTList();
         std::size_t listLen = vtList.size();
-        for (int i = 0; i < listLen; i++) {
+        for (std::size_t i = 0; i < listLen; i++) {
             Str << vtList[i];
             if (i < listLen - 1) {
                 Str << ", ";
@@ -0,0 +1,68 @@
+#include "PathInterner.hxx"
+
+using namespace memory_replay;
+
+PathInterner& PathInterner::global() {
+    static PathInterner interner;
+    return interner;
+}
+
+/**
+ * @param dir directory path, compared byte for byte.
+ * @return the one stored copy of dir.
+*/
+const std::string& PathInterner::intern(std::string_view dir) {
+    // Files arrive a directory at a time, so most lookups repeat this thread's last one.
+    static thread_local const PathInterner* lastInterner = nullptr;
+    static thread_local const std::string* lastDir = nullptr;
+    if (lastInterner == this && *lastDir == dir) {
+        return *lastDir;
+    }
+
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto found = this->m_index.find(dir);
+    const std::string* stored;
+    if (found != this->m_index.end()) {
+        stored = found->second;
+    } else {
+        stored = &this->m_dirs.emplace_back(dir);
+        this->m_index.emplace(*stored, stored);
+    }
+    lastInterner = this;
+    lastDir = stored;
+    return *stored;
+}
+
+/**
+ * @return number of distinct directories stored.
+*/
+std::size_t PathInterner::size() const {
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    return this->m_dirs.size();
+}
+
+/**
+ * Splits a path after its last separator, interning everything before the name.
+*/
+InternedPath::InternedPath(const fs::path& path) {
+    const std::string& native = path.native();
+    std::size_t split = native.rfind('/');
+    split = split == std::string::npos ? 0 : split + 1;
+    this->m_dir = &PathInterner::global().intern(std::string_view(native).substr(0, split));
+    this->m_name = native.substr(split);
+}
+
+fs::path InternedPath::path() const {
+    std::string full;
+    this->appendTo(full);
+    return fs::path(std::move(full));
+}
+
+/**
+ * Appends the full path to out, letting callers reuse one buffer across many paths.
+*/
+void InternedPath::appendTo(std::string& out) const {
+    out.reserve(out.size() + this->size());
+    out += *this->m_dir;
+    out += this->m_name;
+}
@@ -0,0 +1,68 @@
+#ifndef MEMORY_REPLAY_PATH_INTERNER_HXX
+#define MEMORY_REPLAY_PATH_INTERNER_HXX
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    /**
+     * Stores each distinct directory path once, for every catalog object in it to share.
+     *
+     * Directories are kept for the life of the interner and never move, so the references
+     * intern() hands out stay valid and two of them are equal exactly when they are the
+     * same object. Thread safe.
+    */
+    class PathInterner {
+    public:
+        static PathInterner& global();
+
+        const std::string&  intern(std::string_view dir);
+        std::size_t         size() const;
+    private:
+        mutable std::mutex                                          m_mutex;
+        std::deque<std::string>                                     m_dirs;     // Never moves its elements
+        std::unordered_map<std::string_view, const std::string*>    m_index;    // Keys view into m_dirs
+    };
+
+    /**
+     * A file path held as an interned directory and the file's own name. Siblings share
+     * their directory instead of each carrying a copy of it.
+    */
+    class InternedPath {
+    public:
+        InternedPath() : m_dir(&PathInterner::global().intern("")) {};
+        explicit InternedPath(const fs::path& path);
+
+        /**
+         * Directory including its trailing separator, or empty for a bare file name.
+        */
+        const std::string&  dir()   const { return *this->m_dir; };
+        const std::string&  name()  const { return this->m_name; };
+        std::size_t         size()  const { return this->m_dir->size() + this->m_name.size(); };
+
+        fs::path            path()  const;
+        void                appendTo(std::string& out) const;
+
+        bool operator==(const InternedPath& other) const {
+            return this->m_dir == other.m_dir && this->m_name == other.m_name;
+        };
+        bool operator!=(const InternedPath& other) const { return !(*this == other); };
+    private:
+        const std::string*  m_dir;
+        std::string         m_name;
+    };
+
+    inline std::ostream& operator<<(std::ostream& out, const InternedPath& path) {
+        return out << path.path();
+    }
+};
+
+#endif // MEMORY_REPLAY_PATH_INTERNER_HXX
@@ -0,0 +1,133 @@
+#include <stdexcept>
+
+#include "PlistTokenizer.hxx"
+
+using namespace memory_replay;
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+/**
+ * Reads the next token.
+ * @param value receives the text content of leaf elements. Left empty for structural tokens.
+ * @return type of token read. PlistToken::END once the buffer is exhausted.
+*/
+PlistToken PlistTokenizer::next(std::string_view& value) {
+    value = std::string_view();
+
+    if (this->m_hasPending) {
+        this->m_hasPending = false;
+        return this->m_pending;
+    }
+
+    while (true) {
+        std::size_t open = this->m_text.find('<', this->m_pos);
+        if (open == std::string_view::npos) {
+            this->m_pos = this->m_text.size();
+            return PlistToken::END;
+        }
+        std::size_t close = this->m_text.find('>', open);
+        if (close == std::string_view::npos) {
+            throw std::runtime_error("Unterminated plist tag.");
+        }
+        this->m_pos = close + 1;
+
+        std::string_view tag = this->m_text.substr(open + 1, close - open - 1);
+        // XML declaration, DOCTYPE and comments carry nothing we need.
+        if (tag.empty() || tag.front() == '?' || tag.front() == '!') {
+            continue;
+        }
+
+        bool closing = tag.front() == '/';
+        bool selfClosing = tag.back() == '/';
+        if (closing) tag.remove_prefix(1);
+        if (selfClosing) tag.remove_suffix(1);
+        tag = tag.substr(0, tag.find(' '));
+
+        if (tag == "array" || tag == "dict") {
+            bool isArray = tag == "array";
+            if (closing) {
+                return isArray ? PlistToken::ARRAY_END : PlistToken::DICT_END;
+            }
+            // An empty container (<array/>) still opens and closes for the consumer.
+            if (selfClosing) {
+                this->m_pending = isArray ? PlistToken::ARRAY_END : PlistToken::DICT_END;
+                this->m_hasPending = true;
+            }
+            return isArray ? PlistToken::ARRAY_BEGIN : PlistToken::DICT_BEGIN;
+        }
+        if (closing || tag == "plist") {
+            continue;
+        }
+        if (tag == "true" || tag == "false") {
+            value = tag;
+            return PlistToken::BOOLEAN;
+        }
+        if (selfClosing) {
+            return PlistToken::OTHER;
+        }
+
+        value = this->readContent(tag);
+        if (tag == "key") return PlistToken::KEY;
+        if (tag == "string") return PlistToken::STRING;
+        if (tag == "real") return PlistToken::REAL;
+        if (tag == "integer") return PlistToken::INTEGER;
+        return PlistToken::OTHER;
+    }
+}
+
+/**
+ * Skips over the value that produced token, including the whole body of an array or dict.
+ * @param token token most recently returned by next().
+*/
+void PlistTokenizer::skipValue(PlistToken token) {
+    if (token != PlistToken::ARRAY_BEGIN && token != PlistToken::DICT_BEGIN) {
+        return;
+    }
+
+    int depth = 1;
+    std::string_view ignored;
+    while (depth > 0) {
+        switch (this->next(ignored)) {
+            case PlistToken::ARRAY_BEGIN:
+            case PlistToken::DICT_BEGIN:
+                depth++;
+                break;
+            case PlistToken::ARRAY_END:
+            case PlistToken::DICT_END:
+                depth--;
+                break;
+            case PlistToken::END:
+                throw std::runtime_error("Unterminated plist container.");
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * Returns the text between the current position and the matching closing tag,
+ * then moves past that closing tag.
+*/
+std::string_view PlistTokenizer::readContent(std::string_view tagName) {
+    std::size_t end = this->m_text.find("</", this->m_pos);
+    if (end == std::string_view::npos) {
+        throw std::runtime_error("Unterminated plist element.");
+    }
+    std::string_view content = this->m_text.substr(this->m_pos, end - this->m_pos);
+
+    std::size_t close = this->m_text.find('>', end);
+    if (close == std::string_view::npos || this->m_text.substr(end + 2, close - end - 2) != tagName) {
+        throw std::runtime_error("Mismatched plist element.");
+    }
+    this->m_pos = close + 1;
+
+    return trim(content);
+}
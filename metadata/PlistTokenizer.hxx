@@ -0,0 +1,45 @@
+#ifndef MEMORY_REPLAY_PLIST_TOKENIZER_HXX
+#define MEMORY_REPLAY_PLIST_TOKENIZER_HXX
+
+#include <cstddef>
+#include <string_view>
+
+namespace memory_replay {
+    enum class PlistToken {
+        KEY,            // <key>...</key>
+        STRING,         // <string>...</string>
+        REAL,           // <real>...</real>
+        INTEGER,        // <integer>...</integer>
+        BOOLEAN,        // <true/> or <false/>
+        OTHER,          // Any other leaf element (<date>, <data>, ...)
+        ARRAY_BEGIN,    // <array>
+        ARRAY_END,      // </array>
+        DICT_BEGIN,     // <dict>
+        DICT_END,       // </dict>
+        END             // End of input
+    };
+
+    /**
+     * Forward-only pull tokenizer for the XML plist layout used by .modd files.
+     *
+     * Works directly on the caller's buffer; token text is returned as a view into it,
+     * so nothing is copied or allocated while scanning.
+    */
+    class PlistTokenizer {
+    public:
+        explicit PlistTokenizer(std::string_view text) : m_text(text), m_pos(0), m_pending(PlistToken::END), m_hasPending(false) {};
+
+        PlistToken next(std::string_view& value);
+
+        void skipValue(PlistToken token);
+    private:
+        std::string_view    m_text;
+        std::size_t         m_pos;
+        PlistToken          m_pending;      // Token owed after a self-closing container
+        bool                m_hasPending;
+
+        std::string_view readContent(std::string_view tagName);
+    };
+};
+
+#endif // MEMORY_REPLAY_PLIST_TOKENIZER_HXX
@@ -0,0 +1,64 @@
+#include <cerrno>
+
+extern "C" {
+#include <unistd.h>
+};
+
+#include "PoolReadEngine.hxx"
+
+using namespace memory_replay;
+
+PoolReadEngine::PoolReadEngine(unsigned int depth, unsigned int bufferCount) : ReadEngine(depth, bufferCount), m_stop(false) {
+    for (unsigned int i = 0; i < this->m_depth; i++) {
+        this->m_threads.emplace_back([this] { this->serve(); });
+    }
+}
+
+PoolReadEngine::~PoolReadEngine() {
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stop = true;
+    }
+    this->m_requested.notify_all();
+    for (auto& thread : this->m_threads) {
+        thread.join();
+    }
+}
+
+void PoolReadEngine::submit(const ReadRequest& request) {
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_requests.push_back(request);
+    }
+    this->m_requested.notify_one();
+}
+
+ReadCompletion PoolReadEngine::wait() {
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    this->m_completed.wait(lock, [this] { return !this->m_completions.empty(); });
+    ReadCompletion completion = this->m_completions.front();
+    this->m_completions.pop_front();
+    return completion;
+}
+
+/**
+ * Pool thread. Performs queued reads until the engine is destroyed.
+*/
+void PoolReadEngine::serve() {
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    while (true) {
+        this->m_requested.wait(lock, [this] { return this->m_stop || !this->m_requests.empty(); });
+        if (this->m_stop) return;
+
+        ReadRequest request = this->m_requests.front();
+        this->m_requests.pop_front();
+        lock.unlock();
+
+        ssize_t count = pread(request.fd, request.data, request.length, request.offset);
+        ReadCompletion completion = {request.tag, count < 0 ? -static_cast<int64_t>(errno) : count};
+
+        lock.lock();
+        this->m_completions.push_back(completion);
+        this->m_completed.notify_one();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef MEMORY_REPLAY_POOL_READ_ENGINE_HXX
+#define MEMORY_REPLAY_POOL_READ_ENGINE_HXX
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ReadEngine.hxx"
+
+namespace memory_replay {
+    /**
+     * Portable ReadEngine. One thread per unit of depth blocks in pread(2), so the
+     * device still sees depth() reads at once even without io_uring.
+    */
+    class PoolReadEngine : public ReadEngine {
+    public:
+        PoolReadEngine(unsigned int depth, unsigned int bufferCount);
+        ~PoolReadEngine() override;
+
+        void submit(const ReadRequest& request) override;
+        ReadCompletion wait() override;
+    private:
+        std::mutex                  m_mutex;
+        std::condition_variable     m_requested;
+        std::condition_variable     m_completed;
+        std::deque<ReadRequest>     m_requests;
+        std::deque<ReadCompletion>  m_completions;
+        std::vector<std::thread>    m_threads;
+        bool                        m_stop;
+
+        void serve();
+    };
+};
+
+#endif // MEMORY_REPLAY_POOL_READ_ENGINE_HXX
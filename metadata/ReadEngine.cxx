@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+#include "ReadEngine.hxx"
+#include "PoolReadEngine.hxx"
+#include "UringReadEngine.hxx"
+
+using namespace memory_replay;
+
+/**
+ * @param depth most reads in flight at once.
+ * @param bufferCount number of IO_BUFFER_SIZE buffers to allocate.
+*/
+ReadEngine::ReadEngine(unsigned int depth, unsigned int bufferCount) {
+    this->m_depth = depth > 0 ? depth : 1;
+    this->m_bufferCount = bufferCount > 0 ? bufferCount : 1;
+    this->m_buffers = static_cast<uint8_t*>(std::aligned_alloc(IO_BUFFER_ALIGN, this->m_bufferCount * IO_BUFFER_SIZE));
+    if (this->m_buffers == nullptr) {
+        throw std::bad_alloc();
+    }
+}
+
+ReadEngine::~ReadEngine() {
+    std::free(this->m_buffers);
+}
+
+/**
+ * Creates a read engine, falling back from io_uring to the thread pool when io_uring
+ * is unavailable or disabled.
+ * @param engine preferred engine. Must not be IoEngine::INLINE.
+ * @param depth most reads in flight at once.
+ * @param bufferCount number of IO_BUFFER_SIZE buffers.
+*/
+std::unique_ptr<ReadEngine> ReadEngine::create(IoEngine engine, unsigned int depth, unsigned int bufferCount) {
+    if (engine == IoEngine::URING) {
+        try {
+            return std::unique_ptr<ReadEngine>(new UringReadEngine(depth, bufferCount));
+        } catch (const std::runtime_error& e) {
+            std::clog << e.what() << ", using a thread pool instead." << std::endl;
+        }
+    }
+    return std::unique_ptr<ReadEngine>(new PoolReadEngine(depth, bufferCount));
+}
+
+/**
+ * Converts a command line engine name (inline, threads, uring) to an IoEngine.
+ * @return false if the name isn't recognised.
+*/
+bool ReadEngine::parseEngine(const std::string& name, IoEngine& engine) {
+    if (name == "inline") {
+        engine = IoEngine::INLINE;
+    } else if (name == "threads") {
+        engine = IoEngine::THREADS;
+    } else if (name == "uring") {
+        engine = IoEngine::URING;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef MEMORY_REPLAY_READ_ENGINE_HXX
+#define MEMORY_REPLAY_READ_ENGINE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace memory_replay {
+    static const std::size_t IO_BUFFER_SIZE = 1048576;     // 1MiB. Largest single read
+    static const std::size_t IO_BUFFER_ALIGN = 4096;       // Buffers are page aligned
+    static const unsigned int DEFAULT_IO_DEPTH = 64;        // Reads in flight per engine
+    static const unsigned int DEFAULT_IO_BUFFERS = 64;      // Buffers per engine
+
+    /**
+     * How video files are read for hashing.
+    */
+    enum class IoEngine {
+        INLINE,     // Each worker reads and hashes its own file with pread(2).
+        THREADS,    // A pool of threads issues pread(2) calls for a hashing thread.
+        URING       // io_uring, falling back to THREADS if the kernel refuses it.
+    };
+
+    /**
+     * One read into an engine buffer. data must point inside buffer number `buffer`.
+    */
+    struct ReadRequest {
+        int         fd;
+        uint64_t    offset;
+        uint32_t    length;
+        uint8_t*    data;
+        std::size_t buffer;
+        uint64_t    tag;        // Returned with the completion
+    };
+
+    /**
+     * Result of a ReadRequest: bytes read, 0 at end of file, or -errno.
+    */
+    struct ReadCompletion {
+        uint64_t    tag;
+        int64_t     result;
+    };
+
+    /**
+     * Keeps many reads in flight at once and hands back their completions in whatever
+     * order they finish. Owns a fixed set of IO_BUFFER_SIZE buffers for the reads to land in.
+     *
+     * Engines are used from one thread at a time.
+    */
+    class ReadEngine {
+    public:
+        ReadEngine(unsigned int depth, unsigned int bufferCount);
+        virtual ~ReadEngine();
+
+        ReadEngine(const ReadEngine&) = delete;
+        ReadEngine& operator=(const ReadEngine&) = delete;
+
+        /**
+         * Queues a read. It is only guaranteed to be issued by the next wait().
+         * No more than depth() reads may be outstanding at once.
+        */
+        virtual void submit(const ReadRequest& request) = 0;
+
+        /**
+         * Issues queued reads and waits for one to finish. Only call with reads outstanding.
+        */
+        virtual ReadCompletion wait() = 0;
+
+        unsigned int    depth()             const { return this->m_depth; };
+        unsigned int    bufferCount()       const { return this->m_bufferCount; };
+        uint8_t*        buffer(std::size_t index) const { return this->m_buffers + index * IO_BUFFER_SIZE; };
+
+        static std::unique_ptr<ReadEngine> create(IoEngine engine, unsigned int depth, unsigned int bufferCount);
+        static bool parseEngine(const std::string& name, IoEngine& engine);
+    protected:
+        unsigned int    m_depth;
+        unsigned int    m_bufferCount;
+        uint8_t*        m_buffers;      // bufferCount * IO_BUFFER_SIZE bytes
+    };
+};
+
+#endif // MEMORY_REPLAY_READ_ENGINE_HXX
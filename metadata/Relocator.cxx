@@ -0,0 +1,186 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "Relocator.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+static const std::size_t COPY_CHUNK = 8388608;  // 8MiB per copy_file_range/read call
+
+/**
+ * Moves a file to a new path that must not already exist.
+ *
+ * @param from file to move.
+ * @param to destination path. Its parent directory must already exist.
+ * @return how the file was moved and how many bytes were moved or copied.
+*/
+RelocationResult Relocator::move(const fs::path& from, const fs::path& to) {
+    ScopedTimer timer(Stage::RELOCATE);
+    RelocationResult result = {false, RelocationMethod::NONE, 0, 0};
+
+    struct stat srcStat;
+    struct stat dstDirStat;
+    if (stat(from.c_str(), &srcStat) != 0 || stat(to.parent_path().c_str(), &dstDirStat) != 0) {
+        std::cerr << "Failed to relocate " << from << ": " << std::strerror(errno) << std::endl;
+        Stats::global().addError(Stage::RELOCATE);
+        return result;
+    }
+
+    if (srcStat.st_dev == dstDirStat.st_dev) {
+        if (Relocator::rename(from, to)) {
+            result.success = true;
+            result.method = RelocationMethod::RENAME;
+            result.bytesMoved = srcStat.st_size;
+            Stats::global().addItems(Stage::RELOCATE);
+            Stats::global().add(Counter::RELOCATIONS);
+            return result;
+        }
+        // Bind mounts share a device number but still refuse renames across them.
+        if (errno != EXDEV) {
+            std::cerr << "Failed to relocate " << from << ": " << std::strerror(errno) << std::endl;
+            Stats::global().addError(Stage::RELOCATE);
+            return result;
+        }
+    }
+
+    if (!Relocator::copy(from, to, srcStat.st_size, result.method)) {
+        std::cerr << "Failed to relocate " << from << ": " << std::strerror(errno) << std::endl;
+        Stats::global().addError(Stage::RELOCATE);
+        result.method = RelocationMethod::NONE;
+        return result;
+    }
+
+    if (unlink(from.c_str()) != 0) {
+        std::cerr << "Copied but failed to remove " << from << ": " << std::strerror(errno) << std::endl;
+    }
+
+    result.success = true;
+    if (result.method == RelocationMethod::REFLINK) {
+        result.bytesMoved = srcStat.st_size;
+    } else {
+        result.bytesCopied = srcStat.st_size;
+    }
+    Stats::global().addItems(Stage::RELOCATE);
+    Stats::global().add(Counter::RELOCATIONS);
+    return result;
+}
+
+/**
+ * Renames without replacing an existing destination.
+ * @return false with errno set on failure.
+*/
+bool Relocator::rename(const fs::path& from, const fs::path& to) {
+    if (renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) {
+        return true;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+        return false;
+    }
+
+    // Filesystems without RENAME_NOREPLACE still give a no-clobber move via link + unlink.
+    if (link(from.c_str(), to.c_str()) != 0) {
+        return false;
+    }
+    unlink(from.c_str());
+    return true;
+}
+
+/**
+ * Copies from into a newly created to, using the cheapest mechanism that works, and
+ * flushes it and its directory entry to disk. Removes the partial destination on failure.
+ * @param method receives the mechanism that did the copy.
+ * @return false with errno set on failure.
+*/
+bool Relocator::copy(const fs::path& from, const fs::path& to, uint64_t size, RelocationMethod& method) {
+    int src = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+        return false;
+    }
+
+    struct stat srcStat;
+    fstat(src, &srcStat);
+    int dst = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, srcStat.st_mode & 0777);
+    if (dst < 0) {
+        int err = errno;
+        close(src);
+        errno = err;
+        return false;
+    }
+
+    bool success = false;
+    if (ioctl(dst, FICLONE, src) == 0) {
+        method = RelocationMethod::REFLINK;
+        success = true;
+    } else {
+        method = RelocationMethod::COPY_RANGE;
+        uint64_t copied = 0;
+        while (copied < size) {
+            ssize_t count = copy_file_range(src, nullptr, dst, nullptr, COPY_CHUNK, 0);
+            if (count < 0 && errno == EINTR) continue;
+            if (count == 0) errno = ENODATA;   // Source ended early, so it shrank underneath us.
+            if (count <= 0) break;
+            copied += count;
+        }
+        success = copied == size;
+
+        // Nothing copied in-kernel: fall back to plain reads and writes.
+        if (!success && copied == 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+            method = RelocationMethod::COPY;
+            std::vector<char> buffer(COPY_CHUNK);
+            while (copied < size) {
+                ssize_t count = read(src, buffer.data(), buffer.size());
+                if (count < 0 && errno == EINTR) continue;
+                if (count == 0) errno = ENODATA;
+                if (count <= 0) break;
+                ssize_t written = 0;
+                while (written < count) {
+                    ssize_t result = write(dst, buffer.data() + written, count - written);
+                    if (result < 0 && errno == EINTR) continue;
+                    if (result == 0) errno = EIO;
+                    if (result <= 0) break;
+                    written += result;
+                }
+                if (written < count) break;
+                copied += count;
+            }
+            success = copied == size;
+        }
+    }
+
+    if (success) {
+        success = fsync(dst) == 0;
+    }
+    // The caller unlinks the source next, so the new entry must be durable before that.
+    if (success) {
+        fs::path dir = to.parent_path().empty() ? fs::path(".") : to.parent_path();
+        int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        success = dirFd >= 0 && fsync(dirFd) == 0;
+        if (dirFd >= 0) {
+            int syncErr = errno;
+            close(dirFd);
+            errno = syncErr;
+        }
+    }
+
+    int err = errno;
+    close(src);
+    close(dst);
+    if (!success) {
+        unlink(to.c_str());
+    }
+    errno = err;
+
+    return success;
+}
@@ -0,0 +1,42 @@
+#ifndef MEMORY_REPLAY_RELOCATOR_HXX
+#define MEMORY_REPLAY_RELOCATOR_HXX
+
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    enum class RelocationMethod {
+        NONE,           // Nothing was relocated.
+        RENAME,         // renameat2/link on the same filesystem. No data touched.
+        REFLINK,        // FICLONE shared the source's extents. No data touched.
+        COPY_RANGE,     // In-kernel copy_file_range.
+        COPY            // Plain read/write copy.
+    };
+
+    struct RelocationResult {
+        bool                success;
+        RelocationMethod    method;
+        uint64_t            bytesMoved;     // Bytes relocated without copying their data
+        uint64_t            bytesCopied;    // Bytes whose data had to be copied
+    };
+
+    /**
+     * Moves files without ever overwriting an existing destination.
+     *
+     * A rename is tried first whenever source and destination share a device. Otherwise
+     * the file is cloned with FICLONE where the filesystem allows it, then copied with
+     * copy_file_range, then with read/write. The source is only removed once the copy
+     * and its directory entry have been flushed to disk.
+    */
+    class Relocator {
+    public:
+        static RelocationResult move(const fs::path& from, const fs::path& to);
+    private:
+        static bool rename(const fs::path& from, const fs::path& to);
+        static bool copy(const fs::path& from, const fs::path& to, uint64_t size, RelocationMethod& method);
+    };
+};
+
+#endif // MEMORY_REPLAY_RELOCATOR_HXX
@@ -0,0 +1,29 @@
+#ifndef MEMORY_REPLAY_SPAN_HXX
+#define MEMORY_REPLAY_SPAN_HXX
+
+#include <cstddef>
+
+namespace memory_replay {
+    /**
+     * Non-owning view over a contiguous run of objects.
+     * Valid only for as long as the storage it was taken from.
+    */
+    template<typename T>
+    class Span {
+    public:
+        Span() : m_data(nullptr), m_size(0) {};
+        Span(T* data, std::size_t size) : m_data(data), m_size(size) {};
+
+        T*          begin()                         const { return this->m_data; };
+        T*          end()                           const { return this->m_data + this->m_size; };
+        T*          data()                          const { return this->m_data; };
+        std::size_t size()                          const { return this->m_size; };
+        bool        empty()                         const { return this->m_size == 0; };
+        T&          operator[](std::size_t index)   const { return this->m_data[index]; };
+    private:
+        T*          m_data;
+        std::size_t m_size;
+    };
+};
+
+#endif // MEMORY_REPLAY_SPAN_HXX
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+extern "C" {
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+};
+
+#include "UringReadEngine.hxx"
+
+using namespace memory_replay;
+
+/**
+ * Sets up a ring with room for depth reads and registers the engine's buffers with it.
+ * @throws std::runtime_error if the kernel doesn't support or allow io_uring, or can't
+ *         read into the buffers that couldn't be registered.
+*/
+UringReadEngine::UringReadEngine(unsigned int depth, unsigned int bufferCount) : ReadEngine(depth, bufferCount) {
+    this->m_unsubmitted = 0;
+    this->m_fixedBuffers = 0;
+    this->m_sqRing = MAP_FAILED;
+    this->m_cqRing = MAP_FAILED;
+    this->m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    this->m_ringFd = syscall(__NR_io_uring_setup, this->m_depth, &params);
+    if (this->m_ringFd < 0) {
+        throw std::runtime_error("Failed to set up io_uring");
+    }
+
+    this->m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    this->m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        this->m_sqRingSize = std::max(this->m_sqRingSize, this->m_cqRingSize);
+        this->m_cqRingSize = this->m_sqRingSize;
+    }
+
+    this->m_sqRing = mmap(nullptr, this->m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        this->m_ringFd, IORING_OFF_SQ_RING);
+    if (this->m_sqRing != MAP_FAILED) {
+        this->m_cqRing = singleMmap ? this->m_sqRing : mmap(nullptr, this->m_cqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, this->m_ringFd, IORING_OFF_CQ_RING);
+    }
+    this->m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    if (this->m_cqRing != MAP_FAILED) {
+        this->m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, this->m_sqesSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, this->m_ringFd, IORING_OFF_SQES));
+    }
+    if (this->m_sqes == MAP_FAILED) {
+        this->release();
+        throw std::runtime_error("Failed to map io_uring");
+    }
+
+    uint8_t* sq = static_cast<uint8_t*>(this->m_sqRing);
+    this->m_sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+    this->m_sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    this->m_sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    this->m_sqEntries = params.sq_entries;
+    this->m_sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+    uint8_t* cq = static_cast<uint8_t*>(this->m_cqRing);
+    this->m_cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    this->m_cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    this->m_cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    this->m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    this->m_fixedBuffers = this->registerBuffers();
+    if (this->m_fixedBuffers < this->m_bufferCount && !this->supportsRead()) {
+        this->release();
+        throw std::runtime_error("io_uring can't read into unregistered buffers on this kernel");
+    }
+}
+
+/**
+ * Registers as many of the engine's buffers as RLIMIT_MEMLOCK allows, halving the count
+ * until the kernel accepts it. Reports a shortfall once per process.
+ * @return number of buffers registered, starting from the first.
+*/
+unsigned int UringReadEngine::registerBuffers() {
+    std::vector<iovec> iovecs(this->m_bufferCount);
+    for (unsigned int i = 0; i < this->m_bufferCount; i++) {
+        iovecs[i].iov_base = this->buffer(i);
+        iovecs[i].iov_len = IO_BUFFER_SIZE;
+    }
+
+    unsigned int count = this->m_bufferCount;
+    int err = 0;
+    while (count > 0) {
+        if (syscall(__NR_io_uring_register, this->m_ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), count) == 0) {
+            break;
+        }
+        err = errno;
+        // Anything but running out of lockable memory won't go away with fewer buffers.
+        count = err == ENOMEM ? count / 2 : 0;
+    }
+
+    static std::atomic<bool> reported(false);
+    if (count < this->m_bufferCount && !reported.exchange(true)) {
+        std::clog << "Registered " << count << " of " << this->m_bufferCount << " io_uring buffers (" <<
+            std::strerror(err) << "). Raise RLIMIT_MEMLOCK or lower --io-buffers to register them all." << std::endl;
+    }
+    return count;
+}
+
+/**
+ * Asks the kernel whether it supports IORING_OP_READ, which arrived after io_uring
+ * itself. Kernels too old to answer a probe are too old for the opcode as well.
+*/
+bool UringReadEngine::supportsRead() {
+    std::size_t size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    std::vector<uint8_t> storage(size, 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, this->m_ringFd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) != 0) {
+        return false;
+    }
+    return IORING_OP_READ <= probe->last_op && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+UringReadEngine::~UringReadEngine() {
+    this->release();
+}
+
+/**
+ * Unmaps the rings and closes the ring fd. The kernel unregisters the buffers with it.
+*/
+void UringReadEngine::release() {
+    if (this->m_sqes != MAP_FAILED) munmap(this->m_sqes, this->m_sqesSize);
+    if (this->m_cqRing != MAP_FAILED && this->m_cqRing != this->m_sqRing) munmap(this->m_cqRing, this->m_cqRingSize);
+    if (this->m_sqRing != MAP_FAILED) munmap(this->m_sqRing, this->m_sqRingSize);
+    close(this->m_ringFd);
+}
+
+int UringReadEngine::enter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags) {
+    return syscall(__NR_io_uring_enter, this->m_ringFd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+void UringReadEngine::submit(const ReadRequest& request) {
+    unsigned int tail = *this->m_sqTail;
+    while (tail - __atomic_load_n(this->m_sqHead, __ATOMIC_ACQUIRE) >= this->m_sqEntries) {
+        // Only reachable if the caller exceeds depth(); make room by handing the queue over.
+        int submitted = this->enter(this->m_unsubmitted, 0, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            throw std::runtime_error("Failed to submit io_uring reads");
+        }
+        if (submitted > 0) this->m_unsubmitted -= submitted;
+    }
+
+    unsigned int index = tail & this->m_sqMask;
+    io_uring_sqe* sqe = &this->m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request.buffer < this->m_fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = request.fd;
+    sqe->off = request.offset;
+    sqe->addr = reinterpret_cast<uint64_t>(request.data);
+    sqe->len = request.length;
+    sqe->buf_index = static_cast<uint16_t>(request.buffer);
+    sqe->user_data = request.tag;
+
+    this->m_sqArray[index] = index;
+    __atomic_store_n(this->m_sqTail, tail + 1, __ATOMIC_RELEASE);
+    this->m_unsubmitted++;
+}
+
+ReadCompletion UringReadEngine::wait() {
+    while (true) {
+        unsigned int head = *this->m_cqHead;
+        if (head != __atomic_load_n(this->m_cqTail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = this->m_cqes[head & this->m_cqMask];
+            ReadCompletion completion = {cqe.user_data, cqe.res};
+            __atomic_store_n(this->m_cqHead, head + 1, __ATOMIC_RELEASE);
+            return completion;
+        }
+
+        int submitted = this->enter(this->m_unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            throw std::runtime_error("Failed to wait for io_uring reads");
+        }
+        this->m_unsubmitted -= submitted;
+    }
+}
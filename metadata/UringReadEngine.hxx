@@ -0,0 +1,58 @@
+#ifndef MEMORY_REPLAY_URING_READ_ENGINE_HXX
+#define MEMORY_REPLAY_URING_READ_ENGINE_HXX
+
+#include <cstddef>
+
+extern "C" {
+#include <linux/io_uring.h>
+};
+
+#include "ReadEngine.hxx"
+
+namespace memory_replay {
+    /**
+     * ReadEngine on a single io_uring, driven through the raw system calls.
+     *
+     * The engine's buffers are registered with the ring so reads use IORING_OP_READ_FIXED
+     * and skip per-read page pinning. When RLIMIT_MEMLOCK doesn't cover them all, as many
+     * as fit are registered and reads into the rest use plain IORING_OP_READ, which the
+     * kernel is probed for first. Queued reads are submitted together, with a single
+     * io_uring_enter(2) per wait().
+    */
+    class UringReadEngine : public ReadEngine {
+    public:
+        UringReadEngine(unsigned int depth, unsigned int bufferCount);
+        ~UringReadEngine() override;
+
+        void submit(const ReadRequest& request) override;
+        ReadCompletion wait() override;
+    private:
+        int                 m_ringFd;
+        unsigned int        m_fixedBuffers;     // Buffers registered with the ring, from index 0
+        unsigned int        m_unsubmitted;      // Queued in the SQ but not yet entered
+
+        void*               m_sqRing;
+        std::size_t         m_sqRingSize;
+        void*               m_cqRing;
+        std::size_t         m_cqRingSize;
+        io_uring_sqe*       m_sqes;
+        std::size_t         m_sqesSize;
+
+        unsigned int*       m_sqHead;
+        unsigned int*       m_sqTail;
+        unsigned int        m_sqMask;
+        unsigned int        m_sqEntries;
+        unsigned int*       m_sqArray;
+        unsigned int*       m_cqHead;
+        unsigned int*       m_cqTail;
+        unsigned int        m_cqMask;
+        io_uring_cqe*       m_cqes;
+
+        int enter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags);
+        void release();
+        unsigned int registerBuffers();
+        bool supportsRead();
+    };
+};
+
+#endif // MEMORY_REPLAY_URING_READ_ENGINE_HXX
@@ -1,42 +1,34 @@
+#include <charconv>
+#include <stdexcept>
+#include <type_traits>
+
 #include "VT.hxx"
 
 using namespace memory_replay;
 
-VT::VT(std::string vtText) {
-    // Value 0
-    std::string value;
-    std::size_t splitPt = vtText.find(':');
-    value = vtText.substr(0, splitPt);
-
-    this->m_field0 = std::stoul(value, nullptr, 10);
-
-    // Value 1
-    std::size_t oldSplit = splitPt;
-    splitPt = vtText.find(':', splitPt + 1);
-    value = vtText.substr(oldSplit + 1, splitPt);
-    this->m_field1 = std::stoul(value, nullptr, 10);
-
-    // Value 2
-    oldSplit = splitPt;
-    splitPt = vtText.find(':', splitPt + 1);
-    value = vtText.substr(oldSplit + 1, splitPt);
-    this->m_field2 = std::stod(value, nullptr);
-
-    // Value 3
-    oldSplit = splitPt;
-    splitPt = vtText.find(':', splitPt + 1);
-    value = vtText.substr(oldSplit + 1, splitPt);
-    this->m_field3 = std::stod(value, nullptr);
-
-    // Value 4
-    oldSplit = splitPt;
-    splitPt = vtText.find(':', splitPt + 1);
-    value = vtText.substr(oldSplit + 1, splitPt);
-    this->m_field4 = std::stod(value, nullptr);
-
-    // Value 5
-    oldSplit = splitPt;
-    splitPt = vtText.find(':', splitPt + 1);
-    value = vtText.substr(oldSplit + 1, splitPt);
-    this->m_field5 = std::stoul(value, nullptr, 10);
-}
\ No newline at end of file
+static_assert(sizeof(VT) == 40, "VT should pack into 40 bytes");
+static_assert(std::is_trivially_copyable<VT>::value, "VT should be storable by value in a flat array");
+
+/**
+ * Reads the next ':'-separated field of a VT entry and advances past it.
+*/
+template<typename T>
+static void readField(const char*& pos, const char* end, T& out) {
+    auto result = std::from_chars(pos, end, out);
+    if (result.ec != std::errc() || (result.ptr != end && *result.ptr != ':')) {
+        throw std::runtime_error("Malformed VT entry.");
+    }
+    pos = result.ptr == end ? end : result.ptr + 1;
+}
+
+VT::VT(std::string_view vtText) {
+    const char* pos = vtText.data();
+    const char* end = vtText.data() + vtText.size();
+
+    readField(pos, end, this->m_field0);
+    readField(pos, end, this->m_field1);
+    readField(pos, end, this->m_field2);
+    readField(pos, end, this->m_field3);
+    readField(pos, end, this->m_field4);
+    readField(pos, end, this->m_field5);
+}
@@ -1,13 +1,18 @@
 #ifndef MEMORY_REPLAY_VT_HXX
 #define MEMORY_REPLAY_VT_HXX
 
+#include <cstdint>
 #include <sstream>
-#include <string>
+#include <string_view>
 
 namespace memory_replay {
+  /**
+   * One VTList entry. Stored by value so a Modd keeps its whole list in one packed array;
+   * doubles come first to keep the record at 40 bytes with no interior padding.
+  */
   class VT {
   public:
-      explicit VT(std::string vtText);
+      explicit VT(std::string_view vtText);
       uint32_t    getField0() const {return this->m_field0;};
       uint32_t    getField1() const {return this->m_field1;};
       double      getField2() const {return this->m_field2;};
@@ -15,11 +20,11 @@ namespace memory_replay {
       double      getField4() const {return this->m_field4;};
       uint32_t    getField5() const {return this->m_field5;};
   private:
-      uint32_t    m_field0;
-      uint32_t    m_field1;
       double      m_field2;
       double      m_field3;
       double      m_field4;
+      uint32_t    m_field0;
+      uint32_t    m_field1;
       uint32_t    m_field5;
   };
 
@@ -30,4 +35,4 @@ namespace memory_replay {
   }
 };
 
-#endif // MEMORY_REPLAY_VT_HXX
\ No newline at end of file
+#endif // MEMORY_REPLAY_VT_HXX
@@ -1,58 +1,89 @@
-#include <fstream>
+#include <cmath>
 #include <iostream>
+#include <sstream>
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
 
-extern "C" {
-#include <openssl/sha.h>
-};
-
 #include "Video.hxx"
+#include "../stats/Stats.hxx"
 
 using namespace memory_replay;
 
-Video::Video(string name, fs::path loc, uint64_t createTime, double duration, Hash hash) {
-    this->m_name = name;
-    this->m_location = loc;
+Video::Video(const fs::path& loc, uint64_t createTime, double duration, Hash hash, HashStrategy hashStrategy) {
+    this->m_location = InternedPath(loc);
     this->m_creationTime.set(createTime);
     this->m_duration = duration;
+    this->m_streamDuration = 0;
     this->m_hash = hash;
+    this->m_hashStrategy = hashStrategy;
 
-    // Determine which container is being used.
-    std::string vidExt = this->m_location.extension().string();
-    for (const auto& extPair : CONTAINER_MAP) {
-        if (vidExt == extPair.first) {
-            this->m_container = extPair.second;
-            break;
-        }
-    }
-
-    this->m_audCodec = AudioCodec::UNKNOWN;
-
-    if (this->m_container == Container::MPEG) {
-        this->m_vidCodec = VideoCodec::MPEG2;
-    } else {
-        this->m_vidCodec = VideoCodec::UNKNOWN;
-    }
+    this->determineContainer();
 
     this->m_linkedModd = nullptr;
 }
 
-Video::Video(Modd& modd) {
+Video::Video(Modd& modd, HashStrategy hashStrategy) : Video(modd, determineLocation(modd.getPath().path()), hashStrategy) {
+}
+
+/**
+ * Creates the Video for a modd whose video file has already been located.
+ * @param modd the video's .modd file.
+ * @param location path to the video file.
+ * @param hashStrategy parts of the file to hash.
+ * @param hashNow false to leave the hash empty for the caller to set later, along with
+ *                the stream duration, which is only measured here when hashing.
+*/
+Video::Video(Modd& modd, const fs::path& location, HashStrategy hashStrategy, bool hashNow) {
     this->m_linkedModd = &modd;
-    this->m_location = this->determineLocation();
-    this->m_name = this->m_location.filename();
+    this->m_hashStrategy = hashStrategy;
+    this->m_location = InternedPath(location);
     this->m_creationTime.set(this->m_linkedModd->getDateTimeActual());
     this->m_duration = this->m_linkedModd->getDuration();
+    this->m_streamDuration = 0;
 
-    // Determine which container is being used.
-    std::string vidExt = this->m_location.extension().string();
-    for (const auto& extPair : CONTAINER_MAP) {
-        if (vidExt == extPair.first) {
-            this->m_container = extPair.second;
-            break;
-        }
+    this->determineContainer();
+    this->probeContainer(location);
+
+    if (!hashNow) return;
+    this->measureDuration(location);
+    try {
+        this->determineHash(location);
+    } catch (const std::runtime_error& e) {
+        Stats::global().addError(Stage::HASH);
+        std::cerr << e.what() << ": " << location << std::endl;
     }
+}
+
+/**
+ * Creates the Video for a modd using a hash already stored for it, without reading the file.
+ * @param modd the video's .modd file.
+ * @param location path to the video file.
+ * @param hash the stored hash.
+ * @param hashStrategy strategy that produced hash.
+*/
+Video::Video(Modd& modd, const fs::path& location, Hash hash, HashStrategy hashStrategy) {
+    this->m_linkedModd = &modd;
+    this->m_hash = std::move(hash);
+    this->m_hashStrategy = hashStrategy;
+    this->m_location = InternedPath(location);
+    this->m_creationTime.set(this->m_linkedModd->getDateTimeActual());
+    this->m_duration = this->m_linkedModd->getDuration();
+    this->m_streamDuration = 0;
+
+    this->determineContainer();
+    this->probeContainer(location);
+}
+
+/**
+ * Sets the container and codecs from the file extension.
+*/
+void Video::determineContainer() {
+    // Same split as fs::path::extension: a leading dot starts the stem, not an extension.
+    const string& name = this->m_location.name();
+    std::size_t dot = name.rfind('.');
+    bool lowerCase;
+    int extIndex = dot == string::npos || dot == 0 ? -1 : MEDIA_EXTS.find(name.c_str() + dot, name.size() - dot, lowerCase);
+    this->m_container = extIndex >= 0 && extIndex < MODD_EXT_INDEX ? VIDEO_EXT_CONTAINERS[extIndex] : Container::UNKNOWN;
 
     this->m_audCodec = AudioCodec::UNKNOWN;
 
@@ -61,17 +92,40 @@ Video::Video(Modd& modd) {
     } else {
         this->m_vidCodec = VideoCodec::UNKNOWN;
     }
-    
-    try {
-        this->determineHash();
-    } catch (const std::runtime_error& e) {
-        std::cerr << e.what() << ": " << this->m_location << std::endl;
+}
+
+/**
+ * Replaces the container and codecs guessed from the extension with what the file's
+ * own headers say, when it can be read and its container is recognized.
+*/
+void Video::probeContainer(const fs::path& location) {
+    ProbeResult probed;
+    if (MediaProbe::probe(location, probed)) {
+        this->m_container = probed.container;
+        this->m_vidCodec = probed.videoCodec;
+        this->m_audCodec = probed.audioCodec;
+    }
+}
+
+/**
+ * Measures the duration of MPEG program streams from their timestamps and checks it
+ * against the Duration the modd gives.
+ * @param location path to the video file, as getLocation() gives it.
+*/
+void Video::measureDuration(const fs::path& location) {
+    if (this->m_container != Container::MPEG || !MediaProbe::mpegDuration(location, this->m_streamDuration)) {
+        return;
+    }
+
+    double tolerance = std::max(DURATION_TOLERANCE, this->m_duration * DURATION_TOLERANCE_RATIO);
+    if (std::abs(this->m_streamDuration - this->m_duration) > tolerance) {
+        Stats::global().add(Counter::DURATION_MISMATCHES);
+        std::cerr << boost::format("Stream lasts %.2fs but its modd says %.2fs: ") % this->m_streamDuration % this->m_duration;
+        std::cerr << location << std::endl;
     }
-    
 }
 
-fs::path Video::determineLocation() {
-    auto moddPath = this->m_linkedModd->getPath();
+fs::path Video::determineLocation(fs::path moddPath) {
     fs::path videoPath;
     for (const auto& ext : VIDEO_EXTS) {
         // Lower case
@@ -91,65 +145,45 @@ fs::path Video::determineLocation() {
     return videoPath;
 }
 
-void Video::determineHash() {
-    // Read in some of the file.
-    std::ifstream videoFile(this->m_location);
-    if (!videoFile.is_open()) {
-        throw std::runtime_error("Failed to open video file");
-    }
-
-    std::vector<char> fileData;
-    fileData.resize(READ_SIZE);
-
-    videoFile.readsome(fileData.data(), fileData.size());
-
-    videoFile.close();
-
-    this->m_hash.resize(SHA256_DIGEST_LENGTH);
-
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    SHA256_Update(&sha256, fileData.data(), fileData.size());
-    SHA256_Final(this->m_hash.data(), &sha256);
+void Video::determineHash(const fs::path& location) {
+    this->m_hash = Fingerprint::compute(location, this->m_hashStrategy);
 }
 
 /**
- * Uses the creation time data from the video to determine the appropriate directory structure. 
+ * Directory this video belongs in under a library root: the year and month it was recorded.
+ * @param rootDir library root, with a trailing separator.
 */
-bool Video::relocate(const fs::path& rootDir) {
+fs::path Video::relocationDir(const fs::path& rootDir) const {
     std::stringstream newPath;
     newPath << boost::format("%d/%s/") % this->m_creationTime.year() % MONTH_STR[this->m_creationTime.month()];
 
     fs::path outDir = rootDir;
     outDir.concat(newPath.str());
-    
-    bool success;
+    return outDir;
+}
+
+/**
+ * Uses the creation time data from the video to determine the appropriate directory structure. 
+*/
+RelocationResult Video::relocate(const fs::path& rootDir) {
+    fs::path outDir = this->relocationDir(rootDir);
 
     try {
-        success = fs::create_directories(outDir);
+        fs::create_directories(outDir);
     } catch (const fs::filesystem_error& e) {
         std::cerr << e.what() <<  std::endl;
     }
 
     fs::path outPath = outDir;
-    outPath.concat(this->m_name);
+    outPath.concat(this->m_location.name());
 
-    try {
-        success = fs::copy_file(this->m_location, outPath);
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << e.what() << std::endl;
-    }
+    RelocationResult result = Relocator::move(this->m_location.path(), outPath);
+    if (result.success) {
+        this->m_location = InternedPath(outPath);
 
-    try{
-        if (success){
-            success = fs::remove(this->m_location);
-            this->m_location = outPath;
-        }
-    } catch (const fs::filesystem_error& e) {
-        std::cerr << e.what() << std::endl;
+        // The modd only follows once its video has actually moved.
+        this->m_linkedModd->relocate(outDir);
     }
 
-    this->m_linkedModd->relocate(outDir);
-
-    return success;
+    return result;
 }
\ No newline at end of file
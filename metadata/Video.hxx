@@ -1,6 +1,8 @@
 #ifndef MEMORY_REPLAY_VIDEO_HXX
 #define MEMORY_REPLAY_VIDEO_HXX
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
@@ -8,75 +10,87 @@
 
 #include "Modd.hxx"
 #include "Time.hxx"
+#include "Fingerprint.hxx"
+#include "MediaProbe.hxx"
+#include "ExtensionTable.hxx"
+#include "PathInterner.hxx"
 
 namespace fs = std::filesystem;
 using std::string;
 
 namespace memory_replay {
-    static const std::string VIDEO_EXTS[] = {".mpg", ".mpeg", ".mp4", ".m4v", ".mkv", ".avi"};
-
-    static const uint32_t READ_SIZE = 5120000; // 5MiB
-
-    enum class Container {
-        MPEG,       // MPEG-1/2 container.
-        MP4,        // MPEG-4 container.
-        MKV,        // Matroska container.
-        AVI,        // AVI container.
-        UNKNOWN     // Unsupported container.
-    };
-
-    enum class VideoCodec {
-        MPEG2,      // MPEG-2 video codec
-        X264,       // x264 video codec
-        X265,       // x265/HEVC video codec
-        UNKNOWN     // Unsupported video codec
-    };
-
-    enum class AudioCodec {
-        AC3,        // AC3 audio codec
-        AAC,        // AAC audio codec
-        VORBIS,     // Vorbis audio codec
-        UNKNOWN     // Unsupported audio codec
+    static constexpr const char* VIDEO_EXTS[] = {".mpg", ".mpeg", ".mp4", ".m4v", ".mkv", ".avi"};
+    static constexpr std::size_t VIDEO_EXT_COUNT = sizeof(VIDEO_EXTS) / sizeof(VIDEO_EXTS[0]);
+    static constexpr Container VIDEO_EXT_CONTAINERS[] = {
+        Container::MPEG, Container::MPEG, Container::MP4, Container::MP4, Container::MKV, Container::AVI
     };
-
-    static const std::map<std::string, Container> CONTAINER_MAP({
-        {VIDEO_EXTS[0], Container::MPEG},
-        {VIDEO_EXTS[1], Container::MPEG},
-        {VIDEO_EXTS[2], Container::MP4},
-        {VIDEO_EXTS[3], Container::MP4},
-        {VIDEO_EXTS[4], Container::MKV},
-        {VIDEO_EXTS[5], Container::AVI}
+    static_assert(sizeof(VIDEO_EXT_CONTAINERS) / sizeof(VIDEO_EXT_CONTAINERS[0]) == VIDEO_EXT_COUNT,
+        "Every video extension needs a container");
+
+    /**
+     * Every extension a library file can have: the videos, in VIDEO_EXTS order, then .modd.
+    */
+    static constexpr int MODD_EXT_INDEX = VIDEO_EXT_COUNT;
+    static constexpr ExtensionTable<VIDEO_EXT_COUNT + 1> MEDIA_EXTS({
+        VIDEO_EXTS[0], VIDEO_EXTS[1], VIDEO_EXTS[2], VIDEO_EXTS[3], VIDEO_EXTS[4], VIDEO_EXTS[5], ".modd"
     });
 
-    typedef std::vector<uint8_t> Hash;
+    static const double DURATION_TOLERANCE = 1.0;           // Seconds a stream may differ from its modd's Duration
+    static const double DURATION_TOLERANCE_RATIO = 0.01;    // Or this fraction of it, whichever is larger
+
+    /**
+     * Hasher for using a Hash as an unordered container key.
+     * The digest is already uniformly distributed, so its leading bytes are used as-is.
+    */
+    struct HashHasher {
+        std::size_t operator()(const Hash& hash) const {
+            std::size_t value = 0;
+            std::memcpy(&value, hash.data(), std::min(hash.size(), sizeof(value)));
+            return value;
+        };
+    };
 
     class Video {
     public:
-        Video(string name, fs::path loc, uint64_t createTime, double duration, Hash hash);
-        explicit Video(Modd& modd);
+        Video(const fs::path& loc, uint64_t createTime, double duration, Hash hash,
+            HashStrategy hashStrategy = HashStrategy::LEGACY);
+        explicit Video(Modd& modd, HashStrategy hashStrategy = HashStrategy::HEAD);
+        Video(Modd& modd, const fs::path& location, HashStrategy hashStrategy = HashStrategy::HEAD, bool hashNow = true);
+        Video(Modd& modd, const fs::path& location, Hash hash, HashStrategy hashStrategy);
+
+        RelocationResult relocate(const fs::path& rootDir);
+        fs::path    relocationDir(const fs::path& rootDir) const;
+
+        /**
+         * Sets a hash computed elsewhere with this video's strategy.
+        */
+        void        setHash(Hash hash)  { this->m_hash = std::move(hash); };
 
-        bool relocate(const fs::path& rootDir);
+        void        measureDuration(const fs::path& location);
 
         // Getters
         /**
          * Gets the name of the video.
          * @return string containing name.
         */
-        string      getName()           const { return this->m_name; };
-        fs::path    getLocation()       const { return this->m_location; };
-        Time        getCreationTime()   const { return this->m_creationTime; };
-        double      getDuration()       const { return this->m_duration; };
-        Hash        getHash()           const { return this->m_hash; };
-        Container   getContainer()      const { return this->m_container; };
-        VideoCodec  getVideoCodec()     const { return this->m_vidCodec; };
-        AudioCodec  getAudioCodec()     const { return this->m_audCodec; };
-        Modd*       getLinkedModd()     const { return this->m_linkedModd; };
+        const string&       getName()           const { return this->m_location.name(); };
+        const InternedPath& getLocation()       const { return this->m_location; };
+        Time                getCreationTime()   const { return this->m_creationTime; };
+        double              getDuration()       const { return this->m_duration; };
+        double              getStreamDuration() const { return this->m_streamDuration; };
+        const Hash&         getHash()           const { return this->m_hash; };
+        HashStrategy        getHashStrategy()   const { return this->m_hashStrategy; };
+        Container           getContainer()      const { return this->m_container; };
+        VideoCodec          getVideoCodec()     const { return this->m_vidCodec; };
+        AudioCodec          getAudioCodec()     const { return this->m_audCodec; };
+        Modd*               getLinkedModd()     const { return this->m_linkedModd; };
     private:
-        string              m_name;         // Filename
-        fs::path            m_location;     // Path to location on system
+        InternedPath        m_location;     // Path to location on system. Its name is the video's
         Time                m_creationTime; // Unix-based creation time
         double              m_duration;     // Duration in seconds
+        double              m_streamDuration;   // Duration measured from the stream's timestamps. 0 if unknown
         Hash                m_hash;         // SHA-256 based hash
+        HashStrategy        m_hashStrategy; // Parts of the file covered by m_hash
         Container           m_container;    // Container type
         VideoCodec          m_vidCodec;     // Video encoding codec
         AudioCodec          m_audCodec;     // Audio encoding codec
@@ -85,9 +99,11 @@ namespace memory_replay {
         /**
          * Confirms location of video file based on location of associated Modd. 
         */
-        fs::path determineLocation();
+        static fs::path determineLocation(fs::path moddPath);
 
-        void determineHash();
+        void determineContainer();
+        void probeContainer(const fs::path& location);
+        void determineHash(const fs::path& location);
     };
 };
 
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/format.hpp>
+
+#include "DuplicateFinder.hxx"
+#include "../ingest/Scanner.hxx"
+#include "../stats/Stats.hxx"
+
+using namespace memory_replay;
+
+DuplicateFinder::DuplicateFinder(unsigned int workers) : m_workers(workers == 0 ? 1 : workers) {}
+
+/**
+ * Walks searchDir and groups every video found by identical contents.
+ *
+ * @param searchDir root of the directory tree to search.
+ * @return one set per group of identical videos, largest reclaimable space first.
+*/
+std::vector<DuplicateSet> DuplicateFinder::find(const fs::path& searchDir) {
+    std::vector<Candidate> candidates;
+    Scanner::scan(searchDir, [&candidates](ScanItem&& item) {
+        if (!item.video.empty()) {
+            Candidate candidate;
+            candidate.path = std::move(item.video);
+            candidate.hashed = false;
+            if (FileSignature::read(candidate.path, candidate.signature)) {
+                candidates.push_back(std::move(candidate));
+            }
+        }
+        return true;
+    }, this->m_workers);
+
+    // Bucket by size, keeping a single path per inode.
+    std::unordered_map<uint64_t, Group> bySize;
+    std::set<std::pair<uint64_t, uint64_t>> inodes;
+    for (auto& candidate : candidates) {
+        if (inodes.emplace(candidate.signature.device, candidate.signature.inode).second) {
+            bySize[candidate.signature.size].push_back(&candidate);
+        }
+    }
+
+    Group sampled;
+    std::vector<Group> sizeGroups;
+    for (auto& entry : bySize) {
+        if (entry.second.size() > 1) {
+            sampled.insert(sampled.end(), entry.second.begin(), entry.second.end());
+            sizeGroups.push_back(std::move(entry.second));
+        }
+    }
+    this->hashAll(sampled, HashStrategy::SAMPLED);
+
+    // Sampled hashes of small files already cover every byte, so only larger ones need a full pass.
+    std::vector<Group> confirmed;
+    Group full;
+    std::vector<Group> fullGroups;
+    for (const auto& sizeGroup : sizeGroups) {
+        for (auto& group : splitByHash(sizeGroup)) {
+            if (group.front()->signature.size <= 3 * static_cast<uint64_t>(SAMPLE_SIZE)) {
+                confirmed.push_back(std::move(group));
+            } else {
+                full.insert(full.end(), group.begin(), group.end());
+                fullGroups.push_back(std::move(group));
+            }
+        }
+    }
+    this->hashAll(full, HashStrategy::FULL);
+    for (const auto& group : fullGroups) {
+        for (auto& split : splitByHash(group)) {
+            confirmed.push_back(std::move(split));
+        }
+    }
+
+    std::vector<DuplicateSet> sets;
+    sets.reserve(confirmed.size());
+    for (const auto& group : confirmed) {
+        DuplicateSet set;
+        set.size = group.front()->signature.size;
+        for (const auto& candidate : group) {
+            set.paths.push_back(candidate->path);
+        }
+        std::sort(set.paths.begin(), set.paths.end());
+        sets.push_back(std::move(set));
+    }
+    std::sort(sets.begin(), sets.end(), [](const DuplicateSet& a, const DuplicateSet& b) {
+        return a.reclaimable() != b.reclaimable() ? a.reclaimable() > b.reclaimable() : a.paths < b.paths;
+    });
+
+    return sets;
+}
+
+/**
+ * Prints each duplicate set followed by a summary line.
+*/
+void DuplicateFinder::writeReport(std::ostream& out, const std::vector<DuplicateSet>& sets) {
+    uint64_t reclaimable = 0;
+    for (const auto& set : sets) {
+        out << boost::format("%d copies of %d bytes, %d reclaimable:\n") % set.paths.size() % set.size % set.reclaimable();
+        for (const auto& path : set.paths) {
+            out << "  " << path.string() << "\n";
+        }
+        reclaimable += set.reclaimable();
+    }
+    out << boost::format("%d duplicate sets, %d bytes reclaimable.") % sets.size() % reclaimable << std::endl;
+}
+
+/**
+ * Hashes every candidate in group across the worker threads. Candidates that
+ * can't be read are left unhashed.
+*/
+void DuplicateFinder::hashAll(const Group& group, HashStrategy strategy) const {
+    std::atomic<std::size_t> next(0);
+    auto work = [&] {
+        for (std::size_t i = next++; i < group.size(); i = next++) {
+            Candidate& candidate = *group[i];
+            ScopedTimer timer(Stage::HASH);
+            try {
+                candidate.hash = Fingerprint::compute(candidate.path, strategy);
+                candidate.hashed = true;
+                Stats::global().addItems(Stage::HASH);
+            } catch (const std::exception& e) {
+                candidate.hashed = false;
+                Stats::global().addError(Stage::HASH);
+                std::cerr << e.what() << ": " << candidate.path << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned int count = std::min<std::size_t>(this->m_workers, group.size());
+    for (unsigned int i = 1; i < count; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Splits a group into subgroups of matching hashes, dropping any left with one member.
+*/
+std::vector<DuplicateFinder::Group> DuplicateFinder::splitByHash(const Group& group) {
+    std::map<Hash, Group> byHash;
+    for (const auto& candidate : group) {
+        if (candidate->hashed) {
+            byHash[candidate->hash].push_back(candidate);
+        }
+    }
+
+    std::vector<Group> groups;
+    for (auto& entry : byHash) {
+        if (entry.second.size() > 1) {
+            groups.push_back(std::move(entry.second));
+        }
+    }
+    return groups;
+}
@@ -0,0 +1,57 @@
+#ifndef MEMORY_REPLAY_DUPLICATE_FINDER_HXX
+#define MEMORY_REPLAY_DUPLICATE_FINDER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "../metadata/Fingerprint.hxx"
+#include "../metadata/FileSignature.hxx"
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    /**
+     * Videos with identical contents. Every copy past the first could be removed.
+    */
+    struct DuplicateSet {
+        uint64_t                size;       // Bytes per copy
+        std::vector<fs::path>   paths;
+
+        uint64_t reclaimable() const { return this->size * (this->paths.size() - 1); };
+    };
+
+    /**
+     * Finds duplicate videos while reading as little of them as possible.
+     *
+     * Only files that share an exact size can be duplicates, so everything else is
+     * never opened. Files sharing a size are compared by HashStrategy::SAMPLED first,
+     * and only those that still collide are read in full to confirm. Hard links to the
+     * same inode count as one file, since removing one frees nothing.
+    */
+    class DuplicateFinder {
+    public:
+        explicit DuplicateFinder(unsigned int workers);
+
+        std::vector<DuplicateSet> find(const fs::path& searchDir);
+
+        static void writeReport(std::ostream& out, const std::vector<DuplicateSet>& sets);
+    private:
+        struct Candidate {
+            fs::path        path;
+            FileSignature   signature;
+            Hash            hash;
+            bool            hashed;     // False if hashing failed
+        };
+        typedef std::vector<Candidate*> Group;
+
+        unsigned int    m_workers;
+
+        void hashAll(const Group& group, HashStrategy strategy) const;
+        static std::vector<Group> splitByHash(const Group& group);
+    };
+};
+
+#endif // MEMORY_REPLAY_DUPLICATE_FINDER_HXX
@@ -0,0 +1,85 @@
+#ifndef MEMORY_REPLAY_SNAPSHOT_FORMAT_HXX
+#define MEMORY_REPLAY_SNAPSHOT_FORMAT_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * On-disk layout of a catalog snapshot. Shared by the writer and the header-only reader,
+ * so it must not depend on anything else in the tree.
+ *
+ * A snapshot is one file of little-endian, 8-byte aligned sections:
+ *
+ *     SnapshotHeader
+ *     SnapshotModd[moddCount]         sorted by checkCode
+ *     SnapshotVideo[videoCount]       sorted by hash
+ *     uint32_t[moddCount]             modd indexes sorted by dateTime
+ *     uint32_t[videoCount]            video indexes sorted by dateTime
+ *     char[stringsSize]               string pool, each string NUL terminated
+ *
+ * Readers map the file and binary search the sections in place.
+*/
+namespace memory_replay {
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Snapshots are written in host byte order");
+
+    static const char SNAPSHOT_MAGIC[8] = {'M', 'R', 'S', 'N', 'A', 'P', '\r', '\n'};
+    static const uint32_t SNAPSHOT_VERSION = 1;     // Bump on any layout change
+    static const std::size_t SNAPSHOT_HASH_SIZE = 32;
+
+    /**
+     * A string in the pool.
+    */
+    struct SnapshotString {
+        uint64_t    offset;     // From the start of the pool
+        uint32_t    length;     // Excluding the NUL terminator
+        uint32_t    reserved;
+    };
+
+    struct SnapshotHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    headerSize;         // sizeof(SnapshotHeader) when written
+        uint64_t    fileSize;
+        int64_t     createdAt;          // Unix seconds
+        uint32_t    moddCount;
+        uint32_t    videoCount;
+        uint64_t    moddOffset;
+        uint64_t    videoOffset;
+        uint64_t    moddDateIndexOffset;
+        uint64_t    videoDateIndexOffset;
+        uint64_t    stringsOffset;
+        uint64_t    stringsSize;
+    };
+
+    struct SnapshotModd {
+        uint32_t        checkCode;
+        uint32_t        reserved;
+        int64_t         dateTime;
+        double          videoDuration;
+        uint64_t        videoFileSize;
+        SnapshotString  name;
+        SnapshotString  location;       // Path of the .modd file
+    };
+
+    struct SnapshotVideo {
+        uint8_t         hash[SNAPSHOT_HASH_SIZE];
+        uint32_t        moddCheckCode;
+        uint8_t         hashStrategy;   // HashStrategy values
+        uint8_t         container;      // Container values
+        uint8_t         videoCodec;     // VideoCodec values
+        uint8_t         audioCodec;     // AudioCodec values
+        int64_t         dateTime;
+        double          duration;
+        double          streamDuration; // 0 if unknown
+        uint64_t        fileSize;
+        SnapshotString  name;
+        SnapshotString  location;
+    };
+
+    static_assert(sizeof(SnapshotString) == 16, "SnapshotString layout changed");
+    static_assert(sizeof(SnapshotHeader) == 88, "SnapshotHeader layout changed");
+    static_assert(sizeof(SnapshotModd) == 64, "SnapshotModd layout changed");
+    static_assert(sizeof(SnapshotVideo) == 104, "SnapshotVideo layout changed");
+};
+
+#endif // MEMORY_REPLAY_SNAPSHOT_FORMAT_HXX
@@ -0,0 +1,209 @@
+#ifndef MEMORY_REPLAY_SNAPSHOT_READER_HXX
+#define MEMORY_REPLAY_SNAPSHOT_READER_HXX
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+};
+
+#include "SnapshotFormat.hxx"
+
+namespace memory_replay {
+    /**
+     * Read-only view of a catalog snapshot written by SnapshotWriter.
+     *
+     * Header-only and independent of SQLite and the rest of the tree, so other tools can
+     * copy this file and SnapshotFormat.hxx as they are. Opening maps the file and checks
+     * the header; nothing else is read until it is looked up. Lookups are binary searches
+     * over the mapped sections and return pointers into the mapping, valid for the
+     * lifetime of the SnapshotReader.
+    */
+    class SnapshotReader {
+    public:
+        /**
+         * Indexes into videos() or modds() of the records in a dateTime range, in date order.
+        */
+        struct DateRange {
+            const uint32_t* first;
+            const uint32_t* last;
+
+            const uint32_t* begin() const { return this->first; };
+            const uint32_t* end()   const { return this->last; };
+            std::size_t     size()  const { return this->last - this->first; };
+        };
+
+        /**
+         * Maps a snapshot.
+         * @throws std::runtime_error if the file can't be mapped or isn't a snapshot of this version.
+        */
+        explicit SnapshotReader(const std::string& path) : m_data(nullptr), m_size(0) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::runtime_error("Failed to open snapshot " + path);
+            }
+            struct stat fileStat;
+            if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+                close(fd);
+                throw std::runtime_error("Not a catalog snapshot: " + path);
+            }
+            this->m_size = fileStat.st_size;
+            void* data = mmap(nullptr, this->m_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED) {
+                throw std::runtime_error("Failed to map snapshot " + path);
+            }
+            this->m_data = static_cast<const uint8_t*>(data);
+
+            try {
+                this->validate();
+            } catch (...) {
+                munmap(const_cast<uint8_t*>(this->m_data), this->m_size);
+                throw;
+            }
+        };
+
+        ~SnapshotReader() {
+            if (this->m_data != nullptr) {
+                munmap(const_cast<uint8_t*>(this->m_data), this->m_size);
+            }
+        };
+
+        SnapshotReader(SnapshotReader&& other) noexcept : m_data(other.m_data), m_size(other.m_size) {
+            other.m_data = nullptr;
+        };
+        SnapshotReader(const SnapshotReader&) = delete;
+        SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+        const SnapshotHeader&   header()        const { return *reinterpret_cast<const SnapshotHeader*>(this->m_data); };
+        uint32_t                moddCount()     const { return this->header().moddCount; };
+        uint32_t                videoCount()    const { return this->header().videoCount; };
+        const SnapshotModd*     modds()         const { return this->section<SnapshotModd>(this->header().moddOffset); };
+        const SnapshotVideo*    videos()        const { return this->section<SnapshotVideo>(this->header().videoOffset); };
+
+        /**
+         * @param index an index from a DateRange.
+         * @throws std::out_of_range if the snapshot's index was corrupt.
+        */
+        const SnapshotVideo& video(uint32_t index) const {
+            if (index >= this->videoCount()) throw std::out_of_range("Snapshot video index out of range");
+            return this->videos()[index];
+        };
+
+        const SnapshotModd& modd(uint32_t index) const {
+            if (index >= this->moddCount()) throw std::out_of_range("Snapshot modd index out of range");
+            return this->modds()[index];
+        };
+
+        /**
+         * @param hash SNAPSHOT_HASH_SIZE bytes.
+         * @return the video with this hash, or nullptr.
+        */
+        const SnapshotVideo* findVideo(const uint8_t* hash) const {
+            const SnapshotVideo* first = this->videos();
+            const SnapshotVideo* last = first + this->videoCount();
+            const SnapshotVideo* found = std::lower_bound(first, last, hash, [](const SnapshotVideo& video, const uint8_t* key) {
+                return std::memcmp(video.hash, key, SNAPSHOT_HASH_SIZE) < 0;
+            });
+            return found != last && std::memcmp(found->hash, hash, SNAPSHOT_HASH_SIZE) == 0 ? found : nullptr;
+        };
+
+        /**
+         * @return the modd with this CheckCode, or nullptr.
+        */
+        const SnapshotModd* findModd(uint32_t checkCode) const {
+            const SnapshotModd* first = this->modds();
+            const SnapshotModd* last = first + this->moddCount();
+            const SnapshotModd* found = std::lower_bound(first, last, checkCode, [](const SnapshotModd& modd, uint32_t key) {
+                return modd.checkCode < key;
+            });
+            return found != last && found->checkCode == checkCode ? found : nullptr;
+        };
+
+        /**
+         * @return indexes into videos() of every video with from <= dateTime < to.
+        */
+        DateRange videosBetween(int64_t from, int64_t to) const {
+            return this->dateRange(this->videos(), this->videoCount(), this->header().videoDateIndexOffset, from, to);
+        };
+
+        /**
+         * @return indexes into modds() of every modd with from <= dateTime < to.
+        */
+        DateRange moddsBetween(int64_t from, int64_t to) const {
+            return this->dateRange(this->modds(), this->moddCount(), this->header().moddDateIndexOffset, from, to);
+        };
+
+        /**
+         * Resolves a string from the pool.
+         * @throws std::runtime_error if it lies outside the pool.
+        */
+        std::string_view text(const SnapshotString& ref) const {
+            const SnapshotHeader& head = this->header();
+            if (ref.offset > head.stringsSize || ref.length > head.stringsSize - ref.offset) {
+                throw std::runtime_error("Snapshot string out of bounds");
+            }
+            return std::string_view(reinterpret_cast<const char*>(this->m_data + head.stringsOffset + ref.offset), ref.length);
+        };
+    private:
+        const uint8_t*  m_data;
+        std::size_t     m_size;
+
+        template<typename T>
+        const T* section(uint64_t offset) const {
+            return reinterpret_cast<const T*>(this->m_data + offset);
+        };
+
+        template<typename Record>
+        DateRange dateRange(const Record* records, uint32_t count, uint64_t indexOffset, int64_t from, int64_t to) const {
+            const uint32_t* first = this->section<uint32_t>(indexOffset);
+            const uint32_t* last = first + count;
+            auto before = [records, count](uint32_t index, int64_t dateTime) {
+                if (index >= count) throw std::out_of_range("Snapshot date index out of range");
+                return records[index].dateTime < dateTime;
+            };
+            const uint32_t* low = std::lower_bound(first, last, from, before);
+            const uint32_t* high = std::lower_bound(low, last, to, before);
+            return {low, high};
+        };
+
+        /**
+         * Checks that every section the header describes lies inside the file. Indexes
+         * stored in the date sections are checked as they are used.
+        */
+        void validate() const {
+            const SnapshotHeader& head = this->header();
+            if (std::memcmp(head.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+                throw std::runtime_error("Not a catalog snapshot");
+            }
+            if (head.version != SNAPSHOT_VERSION || head.headerSize != sizeof(SnapshotHeader)) {
+                throw std::runtime_error("Unsupported catalog snapshot version");
+            }
+            if (head.fileSize != this->m_size) {
+                throw std::runtime_error("Truncated catalog snapshot");
+            }
+
+            auto inBounds = [this](uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t align) {
+                return offset % align == 0 && offset <= this->m_size && count <= (this->m_size - offset) / recordSize;
+            };
+            if (!inBounds(head.moddOffset, head.moddCount, sizeof(SnapshotModd), alignof(SnapshotModd)) ||
+                !inBounds(head.videoOffset, head.videoCount, sizeof(SnapshotVideo), alignof(SnapshotVideo)) ||
+                !inBounds(head.moddDateIndexOffset, head.moddCount, sizeof(uint32_t), alignof(uint32_t)) ||
+                !inBounds(head.videoDateIndexOffset, head.videoCount, sizeof(uint32_t), alignof(uint32_t)) ||
+                !inBounds(head.stringsOffset, head.stringsSize, 1, 1)) {
+                throw std::runtime_error("Corrupt catalog snapshot");
+            }
+        };
+    };
+};
+
+#endif // MEMORY_REPLAY_SNAPSHOT_READER_HXX
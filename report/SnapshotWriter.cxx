@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+};
+
+#include <boost/format.hpp>
+
+#include "SnapshotWriter.hxx"
+
+using namespace memory_replay;
+
+static const string SNAPSHOT_MODDS_STR =
+    "SELECT checkCode, name, dateTime, videoDuration, videoFileSize, moddFileLocation FROM modd";
+static const string SNAPSHOT_VIDEOS_STR =
+    "SELECT hash, name, moddCheckCode, dateTime, duration, fileLocation, fileSize, hashStrategy, container, videoCodec, "
+    "audioCodec, streamDuration FROM video ORDER BY hash";
+
+/**
+ * Appends NUL terminated strings to the pool.
+*/
+static SnapshotString addString(string& pool, std::string_view value) {
+    SnapshotString ref;
+    ref.offset = pool.size();
+    ref.length = static_cast<uint32_t>(value.size());
+    ref.reserved = 0;
+    pool.append(value.data(), value.size());
+    pool.push_back('\0');
+    return ref;
+}
+
+/**
+ * Reads a codec or container column, which is NULL for rows stored before they were recorded.
+*/
+static uint8_t enumColumn(const Cursor& cursor, int col, uint8_t unknown) {
+    return cursor.isNull(col) ? unknown : static_cast<uint8_t>(cursor.getInt64(col));
+}
+
+/**
+ * Orders record indexes by dateTime, keeping the section's order among equal dates.
+*/
+template<typename Record>
+static std::vector<uint32_t> dateIndex(const std::vector<Record>& records) {
+    std::vector<uint32_t> index(records.size());
+    std::iota(index.begin(), index.end(), 0);
+    std::stable_sort(index.begin(), index.end(), [&records](uint32_t a, uint32_t b) {
+        return records[a].dateTime < records[b].dateTime;
+    });
+    return index;
+}
+
+static void writeAll(int fd, const void* data, std::size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t count = ::write(fd, bytes, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            throw std::runtime_error(string("Failed to write snapshot: ") + std::strerror(errno));
+        }
+        bytes += count;
+        size -= count;
+    }
+}
+
+/**
+ * Writes a snapshot of every modd and video in the catalog to path, replacing any
+ * snapshot already there.
+*/
+void SnapshotWriter::write(const Database& db, const fs::path& path) {
+    string strings;
+    std::vector<SnapshotModd> modds;
+    std::vector<SnapshotVideo> videos;
+
+    Cursor moddRows = db.cursor(SNAPSHOT_MODDS_STR);
+    while (moddRows.step()) {
+        SnapshotModd modd;
+        std::memset(&modd, 0, sizeof(modd));
+        modd.checkCode = static_cast<uint32_t>(moddRows.getInt64(0));
+        modd.name = addString(strings, moddRows.getText(1));
+        modd.dateTime = moddRows.getInt64(2);
+        modd.videoDuration = moddRows.getDouble(3);
+        modd.videoFileSize = moddRows.getInt64(4);
+        modd.location = addString(strings, moddRows.getText(5));
+        modds.push_back(modd);
+    }
+    // CheckCodes are stored as signed ints, so SQL would put every code from 0x80000000 up
+    // first. findModd searches them as unsigned.
+    std::sort(modds.begin(), modds.end(), [](const SnapshotModd& a, const SnapshotModd& b) {
+        return a.checkCode < b.checkCode;
+    });
+
+    Cursor videoRows = db.cursor(SNAPSHOT_VIDEOS_STR);
+    while (videoRows.step()) {
+        Span<const uint8_t> hash = videoRows.getBlob(0);
+        if (hash.size() != SNAPSHOT_HASH_SIZE) {
+            std::cerr << "Skipping video with a " << hash.size() << " byte hash: " << videoRows.getText(5) << std::endl;
+            continue;
+        }
+
+        SnapshotVideo video;
+        std::memset(&video, 0, sizeof(video));
+        std::memcpy(video.hash, hash.data(), SNAPSHOT_HASH_SIZE);
+        video.name = addString(strings, videoRows.getText(1));
+        video.moddCheckCode = static_cast<uint32_t>(videoRows.getInt64(2));
+        video.dateTime = videoRows.getInt64(3);
+        video.duration = videoRows.getDouble(4);
+        video.location = addString(strings, videoRows.getText(5));
+        video.fileSize = videoRows.getInt64(6);
+        video.hashStrategy = static_cast<uint8_t>(videoRows.getInt64(7));
+        video.container = enumColumn(videoRows, 8, static_cast<uint8_t>(Container::UNKNOWN));
+        video.videoCodec = enumColumn(videoRows, 9, static_cast<uint8_t>(VideoCodec::UNKNOWN));
+        video.audioCodec = enumColumn(videoRows, 10, static_cast<uint8_t>(AudioCodec::UNKNOWN));
+        video.streamDuration = videoRows.getDouble(11);
+        videos.push_back(video);
+    }
+
+    std::vector<uint32_t> moddDates = dateIndex(modds);
+    std::vector<uint32_t> videoDates = dateIndex(videos);
+
+    // Every section size is a multiple of 8 up to the date indexes, so each starts aligned.
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.createdAt = std::time(nullptr);
+    header.moddCount = modds.size();
+    header.videoCount = videos.size();
+    header.moddOffset = sizeof(SnapshotHeader);
+    header.videoOffset = header.moddOffset + modds.size() * sizeof(SnapshotModd);
+    header.moddDateIndexOffset = header.videoOffset + videos.size() * sizeof(SnapshotVideo);
+    header.videoDateIndexOffset = header.moddDateIndexOffset + moddDates.size() * sizeof(uint32_t);
+    header.stringsOffset = header.videoDateIndexOffset + videoDates.size() * sizeof(uint32_t);
+    header.stringsSize = strings.size();
+    header.fileSize = header.stringsOffset + header.stringsSize;
+
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create snapshot " + tempPath.string());
+    }
+    try {
+        writeAll(fd, &header, sizeof(header));
+        writeAll(fd, modds.data(), modds.size() * sizeof(SnapshotModd));
+        writeAll(fd, videos.data(), videos.size() * sizeof(SnapshotVideo));
+        writeAll(fd, moddDates.data(), moddDates.size() * sizeof(uint32_t));
+        writeAll(fd, videoDates.data(), videoDates.size() * sizeof(uint32_t));
+        writeAll(fd, strings.data(), strings.size());
+        if (fsync(fd) != 0) {
+            throw std::runtime_error("Failed to sync snapshot " + tempPath.string());
+        }
+    } catch (...) {
+        close(fd);
+        fs::remove(tempPath);
+        throw;
+    }
+    close(fd);
+    fs::rename(tempPath, path);
+
+    std::clog << boost::format("%s: %d modds, %d videos, %d bytes.") % path.string() % modds.size() % videos.size() %
+        header.fileSize << std::endl;
+}
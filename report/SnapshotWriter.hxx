@@ -0,0 +1,25 @@
+#ifndef MEMORY_REPLAY_SNAPSHOT_WRITER_HXX
+#define MEMORY_REPLAY_SNAPSHOT_WRITER_HXX
+
+#include <filesystem>
+
+#include "../database/Database.hxx"
+#include "SnapshotFormat.hxx"
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    /**
+     * Exports the modd and video tables as a catalog snapshot (see SnapshotFormat.hxx)
+     * for tools that only need lookups and shouldn't depend on SQLite.
+     *
+     * The snapshot is built in memory, written beside its destination and renamed over
+     * it, so readers that still have the previous snapshot mapped keep a consistent view.
+    */
+    class SnapshotWriter {
+    public:
+        static void write(const Database& db, const fs::path& path);
+    };
+};
+
+#endif // MEMORY_REPLAY_SNAPSHOT_WRITER_HXX
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/format.hpp>
+
+#include "TranscodeQueue.hxx"
+
+using namespace memory_replay;
+
+// Settings shared by every job, taken from the preset the queues were first built with.
+static const char AUDIO_JSON[] =
+    "            \"Audio\": {\n"
+    "                \"AudioList\": [{\"Bitrate\": 192, \"DRC\": 0.0, \"Encoder\": \"vorbis\", \"Gain\": 0.0, "
+    "\"Mixdown\": \"stereo\", \"Quality\": -3.0, \"Samplerate\": 0, \"Track\": 0}],\n"
+    "                \"CopyMask\": [\"copy:aac\"],\n"
+    "                \"FallbackEncoder\": \"av_aac\"\n"
+    "            },\n";
+static const char FILTERS_JSON[] =
+    "            \"Filters\": {\n"
+    "                \"FilterList\": [\n"
+    "                    {\"ID\": 3, \"Settings\": {\"block-height\": \"16\", \"block-thresh\": \"40\", \"block-width\": \"16\", "
+    "\"filter-mode\": \"2\", \"mode\": \"3\", \"motion-thresh\": \"1\", \"spatial-metric\": \"2\", \"spatial-thresh\": \"1\"}},\n"
+    "                    {\"ID\": 4, \"Settings\": {\"mode\": \"7\"}},\n"
+    "                    {\"ID\": 6, \"Settings\": {\"mode\": 0}},\n"
+    "                    {\"ID\": 8, \"Settings\": {\"cb-spatial\": \"1\", \"cb-temporal\": \"3\", \"cr-spatial\": \"1\", "
+    "\"cr-temporal\": \"3\", \"y-spatial\": \"2\", \"y-temporal\": \"2\"}},\n"
+    "                    {\"ID\": 12, \"Settings\": {\"crop-bottom\": 0, \"crop-left\": 0, \"crop-right\": 0, \"crop-top\": 0, "
+    "\"height\": 480, \"width\": 720}}\n"
+    "                ]\n"
+    "            },\n";
+static const char SUBTITLE_JSON[] =
+    "            \"Subtitle\": {\n"
+    "                \"Search\": {\"Burn\": true, \"Default\": false, \"Enable\": false, \"Forced\": true},\n"
+    "                \"SubtitleList\": []\n"
+    "            },\n";
+
+/**
+ * Writes value as a quoted JSON string.
+*/
+static void writeString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << boost::format("\\u%04x") % static_cast<int>(c);
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+/**
+ * Writes a HandBrake duration object.
+*/
+static void writeDuration(std::ostream& out, double seconds) {
+    uint64_t whole = static_cast<uint64_t>(seconds);
+    out << boost::format("{\"Hours\": %d, \"Minutes\": %d, \"Seconds\": %d, \"Ticks\": %d}") %
+        (whole / 3600) % (whole / 60 % 60) % (whole % 60) % std::llround(seconds * HANDBRAKE_TICKS);
+}
+
+/**
+ * Finds every stored video in an MPEG container with MPEG-2 video, oldest first.
+*/
+std::vector<TranscodeJob> TranscodeQueue::selectJobs(Database& db) {
+    static const string videoSelect =
+        "SELECT fileLocation, dateTime, duration, container, videoCodec, streamDuration FROM video ORDER BY dateTime";
+
+    std::vector<TranscodeJob> jobs;
+    Cursor cursor = db.cursor(videoSelect);
+    while (cursor.step()) {
+        Video video(fs::path(cursor.getText(0)), cursor.getInt64(1), cursor.getDouble(2), Hash());
+
+        // Rows stored before files were probed only have the extension to go on.
+        Container container = cursor.isNull(3) ? video.getContainer() : static_cast<Container>(cursor.getInt64(3));
+        VideoCodec codec = cursor.isNull(4) ? video.getVideoCodec() : static_cast<VideoCodec>(cursor.getInt64(4));
+        if (container != Container::MPEG || codec != VideoCodec::MPEG2) {
+            continue;
+        }
+
+        TranscodeJob job;
+        job.source = video.getLocation().path();
+        job.name = job.source.stem().string();
+        // The measured duration is what the encoder will actually chew through.
+        job.duration = cursor.isNull(5) ? video.getDuration() : cursor.getDouble(5);
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+/**
+ * Splits jobs into shards of nearly equal total duration.
+ *
+ * @param jobs every job to schedule.
+ * @param shards number of shards to fill.
+ * @return the jobs of each shard, longest first.
+*/
+std::vector<std::vector<const TranscodeJob*>> TranscodeQueue::balance(const std::vector<TranscodeJob>& jobs, unsigned int shards) {
+    if (shards == 0) {
+        shards = 1;
+    }
+
+    std::vector<const TranscodeJob*> order;
+    order.reserve(jobs.size());
+    for (const auto& job : jobs) {
+        order.push_back(&job);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const TranscodeJob* a, const TranscodeJob* b) {
+        return a->duration > b->duration;
+    });
+
+    // Min-heap of (total duration, shard index), so the least loaded shard is always on top.
+    typedef std::pair<double, unsigned int> Load;
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+    for (unsigned int i = 0; i < shards; i++) {
+        loads.emplace(0.0, i);
+    }
+
+    std::vector<std::vector<const TranscodeJob*>> result(shards);
+    for (const auto& job : order) {
+        Load least = loads.top();
+        loads.pop();
+        result[least.second].push_back(job);
+        loads.emplace(least.first + job->duration, least.second);
+    }
+
+    return result;
+}
+
+/**
+ * Streams a HandBrake queue holding jobs to out.
+*/
+void TranscodeQueue::writeQueue(std::ostream& out, const std::vector<const TranscodeJob*>& jobs, const QueueOptions& options) {
+    out << "[";
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        const TranscodeJob& job = *jobs[i];
+        fs::path destination = options.outputDir / (job.name + ".mkv");
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\n        \"Job\": {\n";
+        out << AUDIO_JSON;
+
+        out << "            \"Destination\": {\n";
+        out << "                \"AlignAVStart\": false,\n";
+        out << "                \"ChapterList\": [{\"Duration\": ";
+        writeDuration(out, job.duration);
+        out << ", \"Name\": \"Chapter 1\"}],\n";
+        out << "                \"ChapterMarkers\": false,\n";
+        out << "                \"File\": ";
+        writeString(out, destination.string());
+        out << ",\n";
+        out << "                \"InlineParameterSets\": false,\n";
+        out << "                \"Mp4Options\": {\"IpodAtom\": false, \"Mp4Optimize\": false},\n";
+        out << "                \"Mux\": \"mkv\"\n";
+        out << "            },\n";
+
+        out << FILTERS_JSON;
+
+        out << "            \"Metadata\": {\"Name\": ";
+        writeString(out, job.name);
+        out << "},\n";
+        out << "            \"PAR\": {\"Den\": 27, \"Num\": 32},\n";
+        out << "            \"SequenceID\": " << i << ",\n";
+
+        out << "            \"Source\": {\n";
+        out << "                \"Angle\": 0,\n";
+        out << "                \"Path\": ";
+        writeString(out, job.source.string());
+        out << ",\n";
+        out << "                \"Range\": {\"End\": 1, \"Start\": 1, \"Type\": \"chapter\"},\n";
+        out << "                \"Title\": 1\n";
+        out << "            },\n";
+
+        out << SUBTITLE_JSON;
+
+        out << "            \"Video\": {\n";
+        out << "                \"ColorFormat\": 0, \"ColorMatrix\": 6, \"ColorPrimaries\": 6, \"ColorRange\": 1, \"ColorTransfer\": 1,\n";
+        out << "                \"Encoder\": ";
+        writeString(out, options.encoder);
+        out << ",\n";
+        out << "                \"Level\": \"auto\", \"Options\": \"\", \"Preset\": \"medium\", \"Profile\": \"auto\",\n";
+        out << "                \"QSV\": {\"AsyncDepth\": 4, \"Decode\": false},\n";
+        out << boost::format("                \"Quality\": %.1f,\n") % options.quality;
+        out << "                \"Tune\": \"\", \"Turbo\": false, \"TwoPass\": false\n";
+        out << "            }\n";
+        out << "        }\n    }";
+    }
+    out << (jobs.empty() ? "]\n" : "\n]\n");
+}
+
+/**
+ * Writes one queue file per shard, named <prefix>-<n>.json.
+ *
+ * @param db catalog to select videos from.
+ * @param prefix path prefix for the queue files.
+ * @param options shard count and encode settings.
+*/
+void TranscodeQueue::write(Database& db, const fs::path& prefix, const QueueOptions& options) {
+    std::vector<TranscodeJob> jobs = selectJobs(db);
+    auto shards = balance(jobs, options.shards);
+
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        fs::path queuePath = prefix;
+        queuePath += (boost::format("-%d.json") % (i + 1)).str();
+
+        std::ofstream out(queuePath);
+        if (!out) {
+            throw std::runtime_error("Failed to open queue file " + queuePath.string());
+        }
+        writeQueue(out, shards[i], options);
+
+        double total = 0;
+        for (const auto& job : shards[i]) {
+            total += job->duration;
+        }
+        std::clog << boost::format("%s: %d jobs, %.0f seconds of video.") % queuePath.string() % shards[i].size() % total << std::endl;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef MEMORY_REPLAY_TRANSCODE_QUEUE_HXX
+#define MEMORY_REPLAY_TRANSCODE_QUEUE_HXX
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../database/Database.hxx"
+
+namespace fs = std::filesystem;
+
+namespace memory_replay {
+    static const char DEFAULT_ENCODER[] = "nvenc_h265";     // HandBrake video encoder
+    static const double DEFAULT_QUALITY = 16.0;             // Constant quality for DEFAULT_ENCODER
+    static const unsigned int HANDBRAKE_TICKS = 90000;      // HandBrake duration ticks per second
+
+    struct QueueOptions {
+        unsigned int    shards;     // Number of queue files to balance the jobs across
+        fs::path        outputDir;  // Where encoded files are written
+        std::string     encoder;
+        double          quality;
+    };
+
+    /**
+     * One video to transcode.
+    */
+    struct TranscodeJob {
+        std::string     name;       // Output name, without extension
+        fs::path        source;
+        double          duration;   // Seconds
+    };
+
+    /**
+     * Builds HandBrake queue files for every MPEG-2 video in the catalog.
+     *
+     * Jobs are split across shards so each gets close to the same total duration,
+     * using longest-processing-time-first packing: longest job first, always onto the
+     * shard with the least work so far. Each queue is streamed straight to its file.
+    */
+    class TranscodeQueue {
+    public:
+        static std::vector<TranscodeJob> selectJobs(Database& db);
+        static std::vector<std::vector<const TranscodeJob*>> balance(const std::vector<TranscodeJob>& jobs, unsigned int shards);
+        static void writeQueue(std::ostream& out, const std::vector<const TranscodeJob*>& jobs, const QueueOptions& options);
+
+        static void write(Database& db, const fs::path& prefix, const QueueOptions& options);
+    };
+};
+
+#endif // MEMORY_REPLAY_TRANSCODE_QUEUE_HXX
@@ -0,0 +1,97 @@
+#include <boost/format.hpp>
+
+extern "C" {
+#include <pthread.h>
+#include <signal.h>
+};
+
+#include "Stats.hxx"
+
+using namespace memory_replay;
+
+static const char *const COUNTER_NAMES[] = {
+    "filesScanned",
+    "bytesRead",
+    "bytesHashed",
+    "hashesReused",
+    "durationMismatches",
+    "rowsInserted",
+    "rowsUpdated",
+    "rowsSkipped",
+    "relocations"
+};
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == static_cast<std::size_t>(Counter::COUNT),
+    "Every counter needs a name");
+
+static const char *const STAGE_NAMES[] = {
+    "scan",
+    "parse",
+    "hash",
+    "db",
+    "relocate"
+};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<std::size_t>(Stage::COUNT),
+    "Every stage needs a name");
+
+Stats::Stats() {
+    for (auto& counter : this->m_counters) {
+        counter.value = 0;
+    }
+    for (auto& stage : this->m_stages) {
+        stage.items = 0;
+        stage.errors = 0;
+        stage.busyNs = 0;
+    }
+    this->m_start = std::chrono::steady_clock::now();
+}
+
+Stats& Stats::global() {
+    static Stats stats;
+    return stats;
+}
+
+/**
+ * Writes a snapshot of every counter and stage as a single line of JSON.
+*/
+void Stats::writeJson(std::ostream& out) const {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->m_start;
+
+    out << boost::format("{\"elapsedSecs\": %.3f, \"counters\": {") % elapsed.count();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Counter::COUNT); i++) {
+        if (i > 0) out << ", ";
+        out << boost::format("\"%s\": %d") % COUNTER_NAMES[i] % this->m_counters[i].value.load(std::memory_order_relaxed);
+    }
+    out << "}, \"stages\": {";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Stage::COUNT); i++) {
+        const auto& stage = this->m_stages[i];
+        if (i > 0) out << ", ";
+        out << boost::format("\"%s\": {\"items\": %d, \"errors\": %d, \"busySecs\": %.3f}") % STAGE_NAMES[i] %
+            stage.items.load(std::memory_order_relaxed) % stage.errors.load(std::memory_order_relaxed) %
+            (stage.busyNs.load(std::memory_order_relaxed) / 1e9);
+    }
+    out << "}}" << std::endl;
+}
+
+StatsReporter::StatsReporter(std::ostream& out, unsigned int intervalSecs)
+    : m_out(out), m_intervalSecs(intervalSecs), m_stop(false) {
+    this->m_thread = std::thread([this] {
+        // Signals are left to the threads that handle them, such as a Watcher's.
+        sigset_t signals;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        while (!this->m_wake.wait_for(lock, std::chrono::seconds(this->m_intervalSecs), [this] { return this->m_stop; })) {
+            Stats::global().writeJson(this->m_out);
+        }
+    });
+}
+
+StatsReporter::~StatsReporter() {
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stop = true;
+    }
+    this->m_wake.notify_all();
+    this->m_thread.join();
+}
@@ -0,0 +1,115 @@
+#ifndef MEMORY_REPLAY_STATS_HXX
+#define MEMORY_REPLAY_STATS_HXX
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace memory_replay {
+    enum class Stage {
+        SCAN,           // Directory walking
+        PARSE,          // .modd parsing
+        HASH,           // Video fingerprinting
+        DB,             // Database writes
+        RELOCATE,       // File relocation
+        COUNT           // Number of stages. Not a stage.
+    };
+
+    enum class Counter {
+        FILES_SCANNED,  // Regular files seen while scanning
+        BYTES_READ,     // Bytes read from .modd and video files
+        BYTES_HASHED,   // Bytes fed to the video hash
+        HASHES_REUSED,  // Videos given their stored hash instead of being read
+        DURATION_MISMATCHES,    // Streams whose measured duration disagrees with their modd
+        ROWS_INSERTED,  // Rows added to the database
+        ROWS_UPDATED,   // Existing rows changed
+        ROWS_SKIPPED,   // Rows already stored and unchanged
+        RELOCATIONS,    // Files successfully relocated
+        COUNT           // Number of counters. Not a counter.
+    };
+
+    /**
+     * Process-wide counters and per-stage timings.
+     *
+     * Every update is a single relaxed atomic add on its own cache line, so the hot
+     * paths of concurrent stages can record as they go without contending.
+    */
+    class Stats {
+    public:
+        static Stats& global();
+
+        void add(Counter counter, uint64_t amount = 1) {
+            this->m_counters[static_cast<std::size_t>(counter)].value.fetch_add(amount, std::memory_order_relaxed);
+        };
+        void addItems(Stage stage, uint64_t amount = 1) {
+            this->m_stages[static_cast<std::size_t>(stage)].items.fetch_add(amount, std::memory_order_relaxed);
+        };
+        void addError(Stage stage) {
+            this->m_stages[static_cast<std::size_t>(stage)].errors.fetch_add(1, std::memory_order_relaxed);
+        };
+        void addTime(Stage stage, uint64_t nanoseconds) {
+            this->m_stages[static_cast<std::size_t>(stage)].busyNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+        };
+
+        uint64_t get(Counter counter) const {
+            return this->m_counters[static_cast<std::size_t>(counter)].value.load(std::memory_order_relaxed);
+        };
+
+        void writeJson(std::ostream& out) const;
+    private:
+        Stats();
+
+        struct alignas(64) PaddedCounter {
+            std::atomic<uint64_t> value;
+        };
+        struct alignas(64) StageCounters {
+            std::atomic<uint64_t> items;
+            std::atomic<uint64_t> errors;
+            std::atomic<uint64_t> busyNs;   // Summed over every thread working in the stage
+        };
+
+        PaddedCounter   m_counters[static_cast<std::size_t>(Counter::COUNT)];
+        StageCounters   m_stages[static_cast<std::size_t>(Stage::COUNT)];
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /**
+     * Adds the time between its construction and destruction to a stage.
+    */
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage stage) : m_stage(stage), m_start(std::chrono::steady_clock::now()) {};
+        ~ScopedTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - this->m_start;
+            Stats::global().addTime(this->m_stage, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        };
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    private:
+        Stage                                   m_stage;
+        std::chrono::steady_clock::time_point   m_start;
+    };
+
+    /**
+     * Writes the global stats as one line of JSON every interval until destroyed.
+    */
+    class StatsReporter {
+    public:
+        StatsReporter(std::ostream& out, unsigned int intervalSecs);
+        ~StatsReporter();
+    private:
+        std::ostream&           m_out;
+        unsigned int            m_intervalSecs;
+        bool                    m_stop;
+        std::mutex              m_mutex;
+        std::condition_variable m_wake;
+        std::thread             m_thread;
+    };
+};
+
+#endif // MEMORY_REPLAY_STATS_HXX
@@ -0,0 +1,108 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <boost/format.hpp>
+
+#include "../database/Database.hxx"
+#include "../ingest/RelocationExecutor.hxx"
+#include "../ingest/RelocationJournal.hxx"
+
+using namespace memory_replay;
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+static void writeFile(const fs::path& path, const std::string& contents) {
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @return the stored location of the video named name, or "" if there's none.
+*/
+static std::string storedLocation(Database& db, const std::string& name) {
+    Cursor cursor = db.cursor("SELECT fileLocation FROM video WHERE name == '" + name + "'");
+    return cursor.step() ? std::string(cursor.getText(0)) : std::string();
+}
+
+/**
+ * Recovers hand-built journals, one entry for each state a crash can leave a move in.
+*/
+int main() {
+    fs::path dir = fs::temp_directory_path() / "memory-replay-recovery-test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "in");
+    fs::create_directories(dir / "out");
+
+    struct Case {
+        std::string name;
+        bool        writeFrom;  // Source still on disk
+        bool        writeTo;    // Destination on disk
+        bool        done;
+        bool        committed;
+    };
+    const Case cases[] = {
+        {"done", false, true, true, false},             // Moved and synced, catalog not yet updated
+        {"doneCopy", true, true, true, false},          // Copied and synced, original not yet removed
+        {"renamed", false, true, false, false},         // Renamed before the done record landed
+        {"partial", true, true, false, false},          // Copy interrupted part way
+        {"notStarted", true, false, false, false},      // Intent recorded, nothing moved
+        {"committed", false, true, true, true}          // Catalog already follows it
+    };
+
+    {
+        Database db(dir / "catalog.db");
+        RelocationJournal journal(dir / "journal");
+        for (std::size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+            const Case& c = cases[i];
+            fs::path from = dir / "in" / c.name;
+            fs::path to = dir / "out" / c.name;
+            if (c.writeFrom) writeFile(from, "original " + c.name);
+            if (c.writeTo) writeFile(to, c.writeFrom && !c.done ? "part" : "original " + c.name);
+
+            fs::path stored = c.committed ? to : from;
+            db.query(boost::str(boost::format(
+                "INSERT INTO video (hash, name, moddCheckCode, dateTime, duration, fileLocation, fileSize) "
+                "VALUES (x'%02X', '%s', %d, 0, 0, '%s', 0)") % i % c.name % i % stored.string()));
+
+            uint64_t id = journal.intend(from, to);
+            journal.sync(id);
+            if (c.done) journal.done({id});
+            if (c.committed) journal.committed({id});
+        }
+    }
+
+    Database db(dir / "catalog.db");
+    RelocationExecutor::recover(db, dir / "journal");
+
+    check(!fs::exists(dir / "journal"), "journal removed after recovery");
+    for (const Case& c : cases) {
+        fs::path from = dir / "in" / c.name;
+        fs::path to = dir / "out" / c.name;
+        bool moved = c.writeTo && (c.done || !c.writeFrom);
+        if (moved) {
+            check(readFile(to) == "original " + c.name, c.name + ": destination kept");
+            check(storedLocation(db, c.name) == to.string(), c.name + ": catalog points at the destination");
+        } else {
+            check(!fs::exists(to), c.name + ": partial destination removed");
+            check(readFile(from) == "original " + c.name, c.name + ": source kept");
+            check(storedLocation(db, c.name) == from.string(), c.name + ": catalog still points at the source");
+        }
+    }
+
+    fs::remove_all(dir);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "../database/Database.hxx"
+#include "../report/SnapshotReader.hxx"
+#include "../report/SnapshotWriter.hxx"
+
+using namespace memory_replay;
+namespace fs = std::filesystem;
+
+/**
+ * Exports modds whose CheckCodes straddle 0x80000000 and looks every one of them up.
+ * Database binds CheckCodes as signed ints, so codes from 0x80000000 up are stored negative.
+*/
+int main() {
+    fs::path dir = fs::temp_directory_path() / "memory-replay-snapshot-test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    const std::vector<uint32_t> checkCodes = {0x1, 0x7FFFFFFF, 0x80000000, 0x80001234, 0xDEADBEEF, 0xFFFFFFFF, 0x1234};
+
+    int failures = 0;
+    {
+        Database db(dir / "catalog.db");
+        for (uint32_t checkCode : checkCodes) {
+            db.query(boost::str(boost::format(
+                "INSERT INTO modd (checkCode, name, dateTime, videoDuration, videoFileSize, moddFileLocation) "
+                "VALUES (%d, 'clip.modd', 0, 0, 0, '/clips/%X.modd')") % static_cast<int32_t>(checkCode) % checkCode));
+        }
+        SnapshotWriter::write(db, dir / "catalog.snapshot");
+    }
+
+    SnapshotReader reader((dir / "catalog.snapshot").string());
+    if (reader.moddCount() != checkCodes.size()) {
+        std::cerr << "Expected " << checkCodes.size() << " modds, got " << reader.moddCount() << std::endl;
+        failures++;
+    }
+    for (uint32_t checkCode : checkCodes) {
+        const SnapshotModd* modd = reader.findModd(checkCode);
+        if (modd == nullptr || modd->checkCode != checkCode) {
+            std::cerr << boost::format("Modd %08X not found") % checkCode << std::endl;
+            failures++;
+        }
+    }
+    if (reader.findModd(0x80000001) != nullptr) {
+        std::cerr << "Found a modd that was never stored" << std::endl;
+        failures++;
+    }
+
+    fs::remove_all(dir);
+    return failures == 0 ? 0 : 1;
+}